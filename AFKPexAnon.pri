@@ -0,0 +1,39 @@
+# Sources and build settings shared by the application and the benchmarks,
+# on top of the anonymizer in AFKPexAnonCore.pri.
+
+include(AFKPexAnonCore.pri)
+
+SOURCES += \
+    $$PWD/src/afk/journal.cpp \
+    $$PWD/src/afk/filecache.cpp \
+    $$PWD/src/afk/stats.cpp \
+    $$PWD/src/afk/ioring.cpp \
+    $$PWD/src/afk/directorywalker.cpp \
+    $$PWD/src/afk/filenamefilter.cpp \
+    $$PWD/src/afk/filewatcher.cpp \
+    $$PWD/src/afk/filecopy.cpp \
+    $$PWD/src/afk/afkpexanon.cpp
+
+HEADERS += \
+    $$PWD/src/afk/concurrentqueue.hpp \
+    $$PWD/src/afk/journal.hpp \
+    $$PWD/src/afk/filecache.hpp \
+    $$PWD/src/afk/stats.hpp \
+    $$PWD/src/afk/ioring.hpp \
+    $$PWD/src/afk/directorywalker.hpp \
+    $$PWD/src/afk/filenamefilter.hpp \
+    $$PWD/src/afk/filewatcher.hpp \
+    $$PWD/src/afk/filecopy.hpp \
+    $$PWD/src/afk/afkpexanon.hpp
+
+# Optional io_uring file I/O on Linux 5.15 or later: qmake "CONFIG+=io_uring"
+# Uses the kernel interface directly, liburing isn't needed.
+io_uring:linux {
+    DEFINES += AFK_IO_URING
+}
+
+CONFIG(debug, debug|release) {
+    win32-g++:LIBS += -lboost_program_options-mgw53-mt-d-1_65_1
+} else {
+    win32-g++:LIBS += -lboost_program_options-mgw53-mt-1_65_1
+}
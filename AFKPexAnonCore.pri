@@ -0,0 +1,107 @@
+# Sources and build settings of the PEX code and the anonymizer, shared by the
+# library, the application and the benchmarks. The application only sources are
+# in AFKPexAnon.pri.
+
+############################################
+## Library Source Dependencies: Boost, keeg
+## Boost: http://www.boost.org
+## keeg: https://github.com/namralkeeg/keeg
+############################################
+
+INCLUDEPATH += $$(BOOST_ROOT) $$(KEEG_ROOT)/src $$PWD/src
+
+SOURCES += \
+    $$PWD/src/afk/fileformats/pex/pexheader.cpp \
+    $$PWD/src/afk/fileformats/pex/pexview.cpp \
+    $$PWD/src/afk/fileformats/pex/pexbase.cpp \
+    $$PWD/src/afk/fileformats/pex/pexparser.cpp \
+    $$PWD/src/afk/fileformats/pex/pexstringtable.cpp \
+    $$PWD/src/afk/fileformats/pex/pexskyrim.cpp \
+    $$PWD/src/afk/fileformats/pex/pexskyrimse.cpp \
+    $$PWD/src/afk/fileformats/pex/pexfallout4.cpp \
+    $$PWD/src/afk/fileformats/pex/pexfactory.cpp \
+    $$PWD/src/afk/fileformats/pex/pexpool.cpp \
+    $$PWD/src/afk/fileformats/pex/pexnamescanner.cpp \
+    $$PWD/src/afk/fileformats/archive/archive.cpp \
+    $$PWD/src/afk/fileformats/archive/ba2archive.cpp \
+    $$PWD/src/afk/fileformats/archive/bsaarchive.cpp \
+    $$PWD/src/afk/fileformats/archive/archivefactory.cpp \
+    $$PWD/src/afk/xxhash64.cpp \
+    $$PWD/src/afk/pexanonymizer.cpp
+
+HEADERS += \
+    $$PWD/src/version.hpp \
+    $$PWD/src/afk/fileformats/pex/gameid.hpp \
+    $$PWD/src/afk/fileformats/pex/pexheader.hpp \
+    $$PWD/src/afk/fileformats/pex/pexgametraits.hpp \
+    $$PWD/src/afk/fileformats/pex/pexview.hpp \
+    $$PWD/src/afk/fileformats/pex/pexarena.hpp \
+    $$PWD/src/afk/fileformats/pex/pexscript.hpp \
+    $$PWD/src/afk/fileformats/pex/pexparser.hpp \
+    $$PWD/src/afk/fileformats/pex/pexstringtable.hpp \
+    $$PWD/src/afk/fileformats/pex/pexbase.hpp \
+    $$PWD/src/afk/fileformats/pex/pexskyrim.hpp \
+    $$PWD/src/afk/fileformats/pex/pexskyrimse.hpp \
+    $$PWD/src/afk/fileformats/pex/pexfallout4.hpp \
+    $$PWD/src/afk/fileformats/pex/pexfactory.hpp \
+    $$PWD/src/afk/fileformats/pex/pexpool.hpp \
+    $$PWD/src/afk/fileformats/pex/pexnamescanner.hpp \
+    $$PWD/src/afk/fileformats/archive/archive.hpp \
+    $$PWD/src/afk/fileformats/archive/ba2archive.hpp \
+    $$PWD/src/afk/fileformats/archive/bsaarchive.hpp \
+    $$PWD/src/afk/fileformats/archive/archivefactory.hpp \
+    $$PWD/src/afk/xxhash64.hpp \
+    $$PWD/src/afk/pexanonymizer.hpp
+
+# Debug/Release options
+CONFIG(debug, debug|release) {
+        # Debug Options
+    win32-g++ {
+       LIBS += "-L$$(BOOST_LIBRARYDIR_MINGW)"
+       LIBS += -lboost_iostreams-mgw53-mt-d-1_65_1 -lboost_filesystem-mgw53-mt-d-1_65_1 -lboost_system-mgw53-mt-d-1_65_1
+    }
+} else {
+        # Release Options
+    win32-g++ {
+       LIBS += "-L$$(BOOST_LIBRARYDIR_MINGW)"
+       LIBS += -lboost_iostreams-mgw53-mt-1_65_1 -lboost_filesystem-mgw53-mt-1_65_1 -lboost_system-mgw53-mt-1_65_1
+    }
+}
+
+###############################
+## COMPILER SCOPES
+###############################
+
+*msvc* {
+        LIBS += "-L$$(BOOST_LIBRARYDIR)"
+
+        # So VCProj Filters do not flatten headers/source
+        CONFIG -= flat
+
+        # COMPILER FLAGS
+        #  Optimization flags
+        QMAKE_CXXFLAGS_RELEASE -= /O2
+        QMAKE_CXXFLAGS_RELEASE *= /O2 /Ot /Ox /GL
+
+        #  Multithreaded compiling for Visual Studio
+        QMAKE_CXXFLAGS += -MP
+
+        # Linker flags
+        QMAKE_LFLAGS_RELEASE += /LTCG
+}
+
+*-g++ {
+        # COMPILER FLAGS
+
+        #  Optimization flags
+        QMAKE_CXXFLAGS_DEBUG -= -O0 -g
+        QMAKE_CXXFLAGS_DEBUG *= -Og -g3
+        QMAKE_CXXFLAGS_RELEASE -= -O2
+        QMAKE_CXXFLAGS_RELEASE *= -O3 -mfpmath=sse
+
+        #  Extension flags
+        QMAKE_CXXFLAGS_RELEASE += -msse2 -msse
+
+        # Linker flags
+        QMAKE_LFLAGS_RELEASE += -static
+}
@@ -0,0 +1,23 @@
+TEMPLATE = app
+TARGET = afkpexanon_benchmarks
+CONFIG += console c++14 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+include(../AFKPexAnon.pri)
+
+############################################
+## Google Benchmark: https://github.com/google/benchmark
+############################################
+
+INCLUDEPATH += $$(BENCHMARK_ROOT)/include
+LIBS += -L$$(BENCHMARK_ROOT)/lib -lbenchmark
+
+win32:LIBS += -lshlwapi
+
+SOURCES += \
+    pexcorpus.cpp \
+    pexbenchmarks.cpp
+
+HEADERS += \
+    pexcorpus.hpp
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <boost/filesystem.hpp>
+#include <afk/afkpexanon.hpp>
+#include <afk/fileformats/pex/pexarena.hpp>
+#include <afk/fileformats/pex/pexfactory.hpp>
+#include <afk/fileformats/pex/pexheader.hpp>
+#include <afk/fileformats/pex/pexnamescanner.hpp>
+#include <afk/fileformats/pex/pexparser.hpp>
+#include <afk/fileformats/pex/pexpool.hpp>
+#include <afk/fileformats/pex/pexscript.hpp>
+#include <afk/fileformats/pex/pexview.hpp>
+#include "pexcorpus.hpp"
+
+namespace bf = boost::filesystem;
+namespace pex = afk::fileformats::pex;
+using afk::benchmarks::CorpusGame;
+
+namespace {
+
+/// Benchmarks taking a game use its index as the first argument.
+const CorpusGame games[] = { CorpusGame::skyrim, CorpusGame::skyrimSE, CorpusGame::fallout4 };
+const char *gameNames[] = { "Skyrim", "SkyrimSE", "Fallout4" };
+
+void gameArguments(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgName("game");
+    for (int game = 0; game < 3; ++game)
+        benchmark->Arg(game);
+}
+
+std::vector<uint8_t> makeScript(const benchmark::State &state)
+{
+    return afk::benchmarks::makePex(games[state.range(0)]);
+}
+
+std::string toString(const std::vector<uint8_t> &script)
+{
+    return std::string(std::begin(script), std::end(script));
+}
+
+void setLabel(benchmark::State &state, const std::vector<uint8_t> &script)
+{
+    state.SetLabel(gameNames[state.range(0)]);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * script.size()));
+}
+
+void BM_PexHeaderRead(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    for (auto _: state)
+    {
+        pex::PexHeader header;
+        benchmark::DoNotOptimize(header.read(script.data(), script.size()));
+    }
+    state.SetLabel(gameNames[state.range(0)]);
+}
+BENCHMARK(BM_PexHeaderRead)->Apply(gameArguments);
+
+void BM_PexFactoryFromHeader(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexHeader header;
+    header.read(script.data(), script.size());
+    for (auto _: state)
+        benchmark::DoNotOptimize(pex::PexFactory::createUniquePex(header));
+    state.SetLabel(gameNames[state.range(0)]);
+}
+BENCHMARK(BM_PexFactoryFromHeader)->Apply(gameArguments);
+
+void BM_PexFactoryFromStream(benchmark::State &state)
+{
+    const std::string script = toString(makeScript(state));
+    for (auto _: state)
+    {
+        std::istringstream instream(script);
+        benchmark::DoNotOptimize(pex::PexFactory::createUniquePex(instream));
+    }
+    state.SetLabel(gameNames[state.range(0)]);
+}
+BENCHMARK(BM_PexFactoryFromStream)->Apply(gameArguments);
+
+void BM_PexFactoryFromView(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexView view(script.data(), script.size());
+    for (auto _: state)
+        benchmark::DoNotOptimize(pex::PexFactory::createUniquePex(view));
+    state.SetLabel(gameNames[state.range(0)]);
+}
+BENCHMARK(BM_PexFactoryFromView)->Apply(gameArguments);
+
+void BM_PexBaseReadStream(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    const std::string data = toString(script);
+    for (auto _: state)
+    {
+        std::istringstream instream(data);
+        std::unique_ptr<pex::PexBase> pex = pex::PexFactory::createUniquePex(instream);
+        benchmark::DoNotOptimize(pex->read(instream));
+    }
+    setLabel(state, script);
+}
+BENCHMARK(BM_PexBaseReadStream)->Apply(gameArguments);
+
+void BM_PexBaseReadView(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexView view(script.data(), script.size());
+    for (auto _: state)
+    {
+        std::unique_ptr<pex::PexBase> pex = pex::PexFactory::createUniquePex(view);
+        benchmark::DoNotOptimize(pex->read(view));
+    }
+    setLabel(state, script);
+}
+BENCHMARK(BM_PexBaseReadView)->Apply(gameArguments);
+
+void BM_PexPoolReadView(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexView view(script.data(), script.size());
+    pex::PexPool pool;
+    for (auto _: state)
+    {
+        pex::PexPool::Pointer pex = pool.acquire(view);
+        benchmark::DoNotOptimize(pex->read(view));
+    }
+    setLabel(state, script);
+    state.counters["created"] = static_cast<double>(pool.getCreatedCount());
+}
+BENCHMARK(BM_PexPoolReadView)->Apply(gameArguments);
+
+void BM_PexBaseWrite(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexView view(script.data(), script.size());
+    std::unique_ptr<pex::PexBase> pex = pex::PexFactory::createUniquePex(view);
+    pex->read(view);
+    for (auto _: state)
+    {
+        std::ostringstream outstream;
+        benchmark::DoNotOptimize(pex->write(outstream));
+    }
+    setLabel(state, script);
+}
+BENCHMARK(BM_PexBaseWrite)->Apply(gameArguments);
+
+void BM_PexParserParse(benchmark::State &state)
+{
+    const std::vector<uint8_t> script = makeScript(state);
+    pex::PexView view(script.data(), script.size());
+    std::unique_ptr<pex::PexBase> pex = pex::PexFactory::createUniquePex(view);
+    pex->read(view);
+    pex::PexArena arena;
+    for (auto _: state)
+    {
+        pex::PexScript parsed;
+        arena.reset();
+        benchmark::DoNotOptimize(pex->parseData(arena, parsed));
+    }
+    setLabel(state, script);
+}
+BENCHMARK(BM_PexParserParse)->Apply(gameArguments);
+
+void BM_PexNameScanner(benchmark::State &state)
+{
+    /// Script data repeated up to the requested size, with no names in it.
+    const std::vector<uint8_t> script = afk::benchmarks::makePex(CorpusGame::fallout4, 64);
+    std::vector<uint8_t> data;
+    while (data.size() < static_cast<std::size_t>(state.range(0)))
+        data.insert(std::end(data), std::begin(script), std::end(script));
+
+    pex::PexNameScanner scanner;
+    scanner.addName("SomeUserName");
+    scanner.addName("SOME-MACHINE-NAME");
+    for (auto _: state)
+        benchmark::DoNotOptimize(scanner.scan(data.data(), data.size()));
+
+    state.SetLabel(pex::PexNameScanner::getInstructionSet());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(BM_PexNameScanner)->Arg(4 * 1024)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+/// Anonymizes a whole folder, the first argument is the file count and the second the jobs.
+/// The corpus is rebuilt between iterations, since anonymized files are skipped by the next run.
+void BM_AFKPexAnonRun(benchmark::State &state)
+{
+    const bf::path folder = bf::temp_directory_path() / bf::unique_path("afkpexanon-%%%%-%%%%");
+    const std::size_t fileCount = static_cast<std::size_t>(state.range(0));
+    const std::string jobs = std::to_string(state.range(1));
+
+    std::ostringstream output;
+    std::streambuf *coutBuffer = std::cout.rdbuf(output.rdbuf());
+
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        bf::remove_all(folder);
+        afk::benchmarks::writeCorpus(folder, fileCount);
+        output.str(std::string());
+        /// Passed as an option, a bare absolute path would be taken for a slash style option.
+        std::string source = "--source=" + folder.string();
+        std::string jobsOption = "--jobs=" + jobs;
+        char *argv[] = { const_cast<char*>("afkpexanon"), &jobsOption[0], &source[0], nullptr };
+        afk::AFKPexAnon afkPexAnon(3, argv);
+        state.ResumeTiming();
+
+        if (afkPexAnon.run() != EXIT_SUCCESS)
+            state.SkipWithError("Run failed");
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    bf::remove_all(folder);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * fileCount));
+}
+BENCHMARK(BM_AFKPexAnonRun)
+    ->ArgNames({"files", "jobs"})
+    ->ArgsProduct({{1000, 10000, 100000}, {1, 4}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->Iterations(1);
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
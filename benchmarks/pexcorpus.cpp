@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "pexcorpus.hpp"
+#include <fstream>
+
+namespace afk { namespace benchmarks {
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+const std::string userName{"BenchmarkUser"};
+const std::string machineName{"BENCHMARK-PC"};
+
+class PexWriter
+{
+public:
+    explicit PexWriter(bool bigEndian) : m_bigEndian(bigEndian) { }
+
+    void u8(uint8_t value)
+    {
+        m_data.push_back(value);
+    }
+
+    void u16(uint16_t value)
+    {
+        unsignedValue(value, 2);
+    }
+
+    void u32(uint32_t value)
+    {
+        unsignedValue(value, 4);
+    }
+
+    void u64(uint64_t value)
+    {
+        unsignedValue(value, 8);
+    }
+
+    void wstring(const std::string &value)
+    {
+        u16(static_cast<uint16_t>(value.size()));
+        m_data.insert(std::end(m_data), std::begin(value), std::end(value));
+    }
+
+    void identifier(uint16_t index)
+    {
+        u8(1);
+        u16(index);
+    }
+
+    void integer(uint32_t value)
+    {
+        u8(3);
+        u32(value);
+    }
+
+    std::vector<uint8_t>& data() { return m_data; }
+
+private:
+    bool m_bigEndian;
+    std::vector<uint8_t> m_data;
+
+    void unsignedValue(uint64_t value, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            std::size_t shift = m_bigEndian ? (size - 1 - i) * 8 : i * 8;
+            m_data.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+};
+
+} // anonymous namespace
+
+std::vector<uint8_t> makePex(CorpusGame game, std::size_t functionCount, bool redundantStrings)
+{
+    const bool fallout4 = (game == CorpusGame::fallout4);
+    PexWriter writer(!fallout4);
+
+    writer.u32(UINT32_C(0xFA57C0DE));
+    writer.u8(3);
+    writer.u8((game == CorpusGame::skyrim) ? 2 : (game == CorpusGame::skyrimSE) ? 1 : 9);
+    writer.u16(fallout4 ? 2 : 1);
+    writer.u64(UINT64_C(1500000000));
+
+    writer.wstring(fallout4
+                   ? "C:\\Users\\" + userName + "\\AppData\\Local\\Temp\\PapyrusTemp\\"
+                     "Data\\Scripts\\Source\\User\\Benchmark\\Quests\\BenchmarkQuestScript.psc"
+                   : std::string("BenchmarkQuestScript.psc"));
+    writer.wstring(userName);
+    writer.wstring(machineName);
+
+    /// String table: fixed names followed by one name per function.
+    enum : uint16_t { sScript, sEmpty, sForm, sNone, sInt, sDebug, sTrace, sTemp, sValue, sFirstFunction };
+    std::vector<std::string> strings{"BenchmarkQuestScript", "", "Form", "None", "Int",
+                                     "Debug", "Trace", "::temp0", "value"};
+    for (std::size_t i = 0; i < functionCount; ++i)
+        strings.push_back("Function" + std::to_string(i));
+
+    /// Duplicates of Form and value, used in place of the originals by the user flags and iadd.
+    const uint16_t sFormCopy = redundantStrings ? static_cast<uint16_t>(strings.size() + 1) : uint16_t(sForm);
+    const uint16_t sValueCopy = redundantStrings ? static_cast<uint16_t>(strings.size() + 2) : uint16_t(sValue);
+    if (redundantStrings)
+    {
+        strings.push_back("Unused");
+        strings.push_back("Form");
+        strings.push_back("value");
+    }
+
+    writer.u16(static_cast<uint16_t>(strings.size()));
+    for (const auto &string: strings)
+        writer.wstring(string);
+
+    /// Debug info, one entry with a line number per instruction for each function.
+    const uint16_t instructionCount = 4;
+    writer.u8(1);
+    writer.u64(UINT64_C(1499999999));
+    writer.u16(static_cast<uint16_t>(functionCount));
+    for (std::size_t i = 0; i < functionCount; ++i)
+    {
+        writer.u16(sScript);
+        writer.u16(sEmpty);
+        writer.u16(static_cast<uint16_t>(sFirstFunction + i));
+        writer.u8(0);
+        writer.u16(instructionCount);
+        for (uint16_t line = 0; line < instructionCount; ++line)
+            writer.u16(static_cast<uint16_t>(10 * i + line));
+    }
+    if (fallout4)
+    {
+        writer.u16(0);  // property groups
+        writer.u16(0);  // struct orders
+    }
+
+    /// User flags
+    writer.u16(2);
+    writer.u16(sEmpty);
+    writer.u8(0);
+    writer.u16(sFormCopy);
+    writer.u8(1);
+
+    /// One object holding every function in its empty state.
+    PexWriter object(!fallout4);
+    object.u16(sForm);
+    object.u16(sEmpty);
+    if (fallout4)
+        object.u8(0);
+    object.u32(0);
+    object.u16(sEmpty);
+    if (fallout4)
+        object.u16(0);  // structs
+
+    object.u16(1);      // variables
+    object.u16(sValue);
+    object.u16(sInt);
+    object.u32(0);
+    object.integer(0);
+    if (fallout4)
+        object.u8(0);
+
+    object.u16(0);      // properties
+    object.u16(1);      // states
+    object.u16(sEmpty);
+    object.u16(static_cast<uint16_t>(functionCount));
+    for (std::size_t i = 0; i < functionCount; ++i)
+    {
+        object.u16(static_cast<uint16_t>(sFirstFunction + i));
+        object.u16(sNone);
+        object.u16(sEmpty);
+        object.u32(0);
+        object.u8(0);
+        object.u16(0);  // params
+        object.u16(1);  // locals
+        object.u16(sTemp);
+        object.u16(sNone);
+        object.u16(instructionCount);
+
+        /// callstatic Debug Trace ::temp0 1 value
+        object.u8(0x19);
+        object.identifier(sDebug);
+        object.identifier(sTrace);
+        object.identifier(sTemp);
+        object.integer(1);
+        object.identifier(sValue);
+        /// iadd value value 1
+        object.u8(0x01);
+        object.identifier(sValueCopy);
+        object.identifier(sValue);
+        object.integer(1);
+        /// assign value 0
+        object.u8(0x0d);
+        object.identifier(sValue);
+        object.integer(0);
+        /// return none
+        object.u8(0x1a);
+        object.u8(0);
+    }
+
+    writer.u16(1);
+    writer.u16(sScript);
+    writer.u32(static_cast<uint32_t>(object.data().size() + sizeof(uint32_t)));
+    writer.data().insert(std::end(writer.data()), std::begin(object.data()), std::end(object.data()));
+
+    return std::move(writer.data());
+}
+
+void writeCorpus(const bf::path &folder, std::size_t fileCount, std::size_t functionCount)
+{
+    const std::vector<uint8_t> scripts[] = {
+        makePex(CorpusGame::skyrim, functionCount),
+        makePex(CorpusGame::skyrimSE, functionCount),
+        makePex(CorpusGame::fallout4, functionCount),
+    };
+
+    bf::create_directories(folder);
+    for (std::size_t i = 0; i < fileCount; ++i)
+    {
+        const std::vector<uint8_t> &script = scripts[i % 3];
+        std::ofstream file((folder / ("script" + std::to_string(i) + ".pex")).string(),
+                           std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(script.data()), script.size());
+    }
+}
+
+} // benchmarks namespace
+} // afk namespace
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXCORPUS_HPP
+#define PEXCORPUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace afk { namespace benchmarks {
+
+enum class CorpusGame
+{
+    skyrim,
+    skyrimSE,
+    fallout4,
+};
+
+/// Builds a complete, parseable pex file with the given number of functions.
+/// Fallout 4 files get the long temporary folder source path the compiler writes.
+/// With redundantStrings the string table also holds an unused string and two duplicates
+/// that are referenced, so compacting it has something to remove and remap.
+std::vector<uint8_t> makePex(CorpusGame game, std::size_t functionCount = 8, bool redundantStrings = false);
+
+/// Fills a folder with fileCount scripts, cycling through the games.
+void writeCorpus(const boost::filesystem::path &folder, std::size_t fileCount,
+                 std::size_t functionCount = 8);
+
+} // benchmarks namespace
+} // afk namespace
+
+#endif // PEXCORPUS_HPP
@@ -0,0 +1,29 @@
+# Static library of the anonymizer, with the C++ API in afk/pexanonymizer.hpp
+# and the C API in afk/pexanon.h. For a shared library run
+# qmake "CONFIG+=pexanon_shared"
+
+TEMPLATE = lib
+TARGET = afkpexanon
+CONFIG += c++14 thread staticlib
+CONFIG -= qt
+
+include(../AFKPexAnonCore.pri)
+
+SOURCES += \
+    ../src/afk/pexanon.cpp
+
+HEADERS += \
+    ../src/afk/pexanon.h
+
+pexanon_shared {
+    CONFIG -= staticlib
+    CONFIG += shared
+    DEFINES += PEXANON_SHARED PEXANON_BUILD
+    QMAKE_LFLAGS_RELEASE -= -static
+}
+
+###############################
+## Version Info
+###############################
+
+VERSION = 1.1.0 # major.minor.patch
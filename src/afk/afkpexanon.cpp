@@ -20,19 +20,50 @@
  * IN THE SOFTWARE.
  */
 #include "afkpexanon.hpp"
-#include <afk/fileformats/pex/pexfactory.hpp>
-#include <keeg/common/enums.hpp>
+#include <afk/xxhash64.hpp>
+#include <afk/directorywalker.hpp>
+#include <afk/filecopy.hpp>
+#include <afk/filewatcher.hpp>
+#include <afk/fileformats/archive/archivefactory.hpp>
+#include <keeg/io/binaryreaders.hpp>
+#include <keeg/io/binarywriters.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
 #include <cstdlib>
 #include <fstream>
 #include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 namespace afk {
 
 using namespace std;
 using namespace afk::fileformats::pex;
+using namespace afk::fileformats::archive;
 namespace bf = boost::filesystem;
 namespace bpo = boost::program_options;
+namespace ke = keeg::endian;
+namespace ki = keeg::io;
+
+namespace {
+
+/// Set by Ctrl+C, ends --watch after the files already found are done.
+volatile std::sig_atomic_t stopRequested = 0;
+
+extern "C" void requestStop(int)
+{
+    stopRequested = 1;
+}
+
+} // anonymous namespace
 
 AFKPexAnon::AFKPexAnon(const int &argc, char *argv[]) : m_argc(argc), m_argv(argv)
 { }
@@ -55,174 +86,1225 @@ int AFKPexAnon::run()
         return EXIT_SUCCESS;
     }
 
+    if (!m_statsFileName.empty())
+        m_stats.enable();
+
+    PexAnonymizer::Options options;
+    options.mask = m_mask;
+    options.stripDebug = m_stripDebug;
+    options.compactStrings = m_compactStrings;
+    options.maskNames = m_maskNames;
+    options.verbose = m_verboseMode;
+    m_anonymizer.setOptions(options);
+    compileFileFilter();
+
+    try
+    {
+        if (m_stdin && (m_filesFromName == "-"))
+            throw std::runtime_error("The file list can't be read from stdin while it carries the scripts");
+
+        /// A pipeline has no files to search, resume or remember.
+        if (m_stdin)
+        {
+            if (m_stats.isEnabled() && (m_statsFileName == "-"))
+                throw std::runtime_error("The stats can't go to the console while it carries the scripts");
+
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            bool status = processStream(std::cin, std::cout, std::cerr);
+            if (m_stats.isEnabled() && !m_stats.write(m_statsFileName))
+            {
+                std::cerr << "Unable to write stats file: " << m_statsFileName << std::endl;
+                status = false;
+            }
+
+            return status ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        if (m_watch && !m_filesFromName.empty())
+            throw std::runtime_error("Watching can't be combined with a file list");
+
+        /// Checking doesn't change anything, so there's nothing to resume or remember.
+        if (m_checkOnly)
+        {
+            m_journalFileName.clear();
+            m_cacheFileName.clear();
+        }
+
+        /// A watched file is processed again each time it's compiled.
+        if (m_watch)
+            m_journalFileName.clear();
+
+        /// Files finished by an interrupted run are skipped.
+        if (!m_journalFileName.empty() && !m_journal.open(m_journalFileName))
+            throw std::runtime_error("Unable to open journal file: " + m_journalFileName);
+
+        /// Files that haven't changed since an earlier run are skipped.
+        if (!m_cacheFileName.empty() && !m_cache.load(m_cacheFileName, getCacheSettings()))
+            throw std::runtime_error("Unable to read cache file: " + m_cacheFileName);
+
+        if (m_verboseMode)
+            std::cout << "Name scanner: " << PexNameScanner::getInstructionSet() << std::endl;
+
+        if (m_ioUring && !IoRing().open())
+        {
+            std::cerr << (IoRing::isAvailable() ? "io_uring isn't supported by the kernel"
+                                                : "Built without io_uring support")
+                      << ", using the standard file I/O." << std::endl;
+            m_ioUring = false;
+        }
+
+        /// Files are processed while the folders are still being searched.
+        ConcurrentQueue<bf::path> entries{defaultQueueCapacity};
+        std::thread finder([this, &entries]() {
+            if (m_watch)
+                watchFiles(entries);
+            else
+                findFiles(entries);
+        });
+
+        bool status = processFiles(entries);
+        finder.join();
+
+        /// Files that weren't found weren't anonymized, the journal has to stay for the next run.
+        if (m_isSearchFailed || m_isListIncomplete || m_isWatchFailed)
+            status = false;
+
+        if (m_cache.isOpen() && !m_cache.save())
+        {
+            std::cerr << "Unable to write cache file: " << m_cacheFileName << std::endl;
+            status = false;
+        }
+
+        if (m_stats.isEnabled() && !m_stats.write(m_statsFileName))
+        {
+            std::cerr << "Unable to write stats file: " << m_statsFileName << std::endl;
+            status = false;
+        }
+
+        if (!status)
+        {
+            /// The next run resumes from the journal.
+            if (m_journal.isOpen() && !m_journal.sync())
+                std::cerr << "Unable to sync journal file: " << m_journalFileName << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        /// Everything is done, the next run starts from scratch.
+        if (m_journal.isOpen())
+            m_journal.remove();
+
+        if (m_checkOnly && (m_leakingCount > 0))
+            return leakingExitCode;
+    }
+    catch (std::exception const &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void AFKPexAnon::findFiles(ConcurrentQueue<bf::path> &entries)
+{
+    auto addEntry = [this, &entries](const bf::path &entry, Stats::StageTimer &traversal)
+    {
+        if (m_journal.isOpen() && m_journal.contains(getEntryKey(entry)))
+        {
+            m_stats.increment(Stats::Counter::alreadyProcessed);
+            if (m_verboseMode)
+                std::cout << "Already processed: " << entry << std::endl;
+            return true;
+        }
+
+        if (m_cache.isOpen() && isCached(entry, false))
+        {
+            m_stats.increment(Stats::Counter::unchanged);
+            if (m_verboseMode)
+                std::cout << "Unchanged: " << entry << std::endl;
+            return true;
+        }
+
+        m_stats.increment(Stats::Counter::found);
+
+        /// Waiting for the workers to catch up isn't part of the search.
+        Stats::Clock::time_point waitStart = Stats::Clock::now();
+        bool isAdded = entries.push(entry);
+        traversal.exclude(Stats::Clock::now() - waitStart);
+        return isAdded;
+    };
+
     try
     {
-        std::vector<bf::path> entries;
+        /// A list of files replaces the search of the source folders.
+        if (!m_filesFromName.empty())
+        {
+            if (m_verboseMode)
+                std::cout << "Reading file list: " << m_filesFromName << std::endl;
+
+            Stats::StageTimer traversal(m_stats, Stats::Stage::traversal);
+            auto add = [this, &addEntry, &traversal](const std::string &path)
+            {
+                if (!m_fileFilter.matches(bf::path(path).filename().string()))
+                    return true;
+
+                if (!bf::is_regular_file(path))
+                {
+                    std::cerr << "File not found: " << path << std::endl;
+                    m_stats.increment(Stats::Counter::failed);
+                    m_isListIncomplete = true;
+                    return true;
+                }
+
+                return addEntry(path, traversal);
+            };
+
+            if (m_filesFromName == "-")
+            {
+                readFileList(std::cin, add);
+            }
+            else
+            {
+                std::ifstream list(m_filesFromName, std::ios::binary);
+                if (!list)
+                {
+                    m_isListIncomplete = true;
+                    throw std::runtime_error("Unable to read file list: " + m_filesFromName);
+                }
+                readFileList(list, add);
+            }
+
+            entries.close();
+            return;
+        }
+
+        /// Subfolders are read on as many threads as there are workers.
+        DirectoryWalker walker(getJobCount());
+        auto isValidName = [this](boost::string_view fileName) { return m_fileFilter.matches(fileName); };
+        auto isSearched = [this](boost::string_view folderName) { return !m_fileFilter.isExcluded(folderName); };
+
         for (const auto &dir: m_sourceFolders)
         {
             if (m_verboseMode)
                 std::cout << "Searching: " << dir << std::endl;
 
-            /// Recursively add files from subfolders.
-            if (m_recursiveFolders)
+            Stats::StageTimer traversal(m_stats, Stats::Stage::traversal);
+            auto add = [&addEntry, &traversal](const std::string &path) { return addEntry(path, traversal); };
+
+            /// Without recursion only the files in the root of each folder are added.
+            if (!walker.walk(dir, m_recursiveFolders, isValidName, add, isSearched))
+                return;
+
+            /// The rest of the folder is still searched, but the run can't count as complete.
+            if (walker.hasErrors())
+                m_isSearchFailed = true;
+        }
+    }
+    catch (std::exception const &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        m_isSearchFailed = true;
+    }
+
+    entries.close();
+}
+
+void AFKPexAnon::watchFiles(ConcurrentQueue<bf::path> &entries)
+{
+    FileWatcher watcher([this](boost::string_view folderName) { return !m_fileFilter.isExcluded(folderName); });
+
+    try
+    {
+        if (!watcher.open())
+            throw std::runtime_error("Unable to watch the source folders");
+
+        for (const auto &dir: m_sourceFolders)
+        {
+            if (m_verboseMode)
+                std::cout << "Watching: " << dir << std::endl;
+
+            if (!watcher.addFolder(dir, m_recursiveFolders))
+                throw std::runtime_error("Unable to watch the source folders");
+        }
+
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+        std::cout << "Watching for changes, press Ctrl+C to stop." << std::endl;
+
+        std::vector<std::string> paths;
+        while (!stopRequested)
+        {
+            /// Wakes up now and then to notice a stop request.
+            if (!watcher.wait(paths, watchPollInterval, watchDebounce))
+                throw std::runtime_error("Unable to read file changes");
+
+            for (const auto &path: paths)
+            {
+                if (!m_fileFilter.matches(bf::path(path).filename().string()))
+                    continue;
+
+                /// Also skips the changes made by the workers themselves, once the cache has them.
+                if (m_cache.isOpen() && isCached(path, false))
+                {
+                    m_stats.increment(Stats::Counter::unchanged);
+                    continue;
+                }
+
+                m_stats.increment(Stats::Counter::found);
+                if (!entries.push(path))
+                    break;
+            }
+            paths.clear();
+        }
+
+        std::cout << "Stopped watching." << std::endl;
+    }
+    catch (std::exception const &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        m_isWatchFailed = true;
+    }
+
+    entries.close();
+}
+
+bool AFKPexAnon::readFileList(std::istream &list, const std::function<bool(const std::string &)> &callback)
+{
+    /// The first separator decides the format, so the output of find -print0 works as is.
+    char separator = '\0';
+    bool isSeparatorKnown = false;
+    std::string path;
+
+    auto flush = [&]()
+    {
+        /// Lists written on Windows end their lines with \r\n.
+        if (!path.empty() && (separator == '\n') && (path.back() == '\r'))
+            path.pop_back();
+
+        bool isRunning = path.empty() || callback(path);
+        path.clear();
+        return isRunning;
+    };
+
+    for (std::istreambuf_iterator<char> it(list), end; it != end; ++it)
+    {
+        const char c = *it;
+        if (!isSeparatorKnown && ((c == '\0') || (c == '\n')))
+        {
+            separator = c;
+            isSeparatorKnown = true;
+        }
+
+        if (isSeparatorKnown && (c == separator))
+        {
+            if (!flush())
+                return false;
+        }
+        else
+        {
+            path.push_back(c);
+        }
+    }
+
+    return flush();
+}
+
+bool AFKPexAnon::processFiles(ConcurrentQueue<bf::path> &entries)
+{
+    std::size_t jobs = getJobCount();
+
+    /// Output of each file is buffered, so the report can be sorted once everything is done.
+    std::vector<ProcessResult> results;
+    std::atomic<bool> failed{false};
+    std::mutex resultsMutex;
+
+    auto worker = [&]()
+    {
+        ProcessResult result;
+        PexPool pool;
+        RingWorker ringWorker;
+        if (m_ioUring)
+            ringWorker.ring.open();
+
+        while (!failed && entries.pop(result.path))
+        {
+            std::ostringstream out;
+            try
             {
-                for (auto &entry: traverseDirectoryRecursive(dir))
-                    if (isValidFile(entry))
-                        entries.push_back(entry.path());
+                Stats::StageTimer fileTimer(m_stats, Stats::Stage::file);
+
+                /// The file was touched but its content is the same as last time.
+                if (m_cache.isOpen() && isCached(result.path, true))
+                {
+                    m_stats.increment(Stats::Counter::unchanged);
+                    result.status = FileStatus::clean;
+                    if (m_verboseMode)
+                        out << "Unchanged: " << result.path << std::endl;
+                }
+                else
+                {
+                    FileStatus status;
+                    FileHash hash;
+                    if (m_checkOnly)
+                        status = checkFile(result.path, pool, out);
+                    else if (isArchive(result.path))
+                        status = processArchive(result.path, pool, out);
+                    else if (ringWorker.ring.isOpen() && !m_inPlace)
+                        status = processFileRing(result.path, pool, ringWorker, out, hash);
+                    else
+                        status = processFile(result.path, pool, out, hash);
+                    m_stats.increment(getCounter(status));
+                    result.status = status;
+                    if (m_cache.isOpen())
+                        updateCache(result.path, status, hash);
+                }
+
+                /// A failed file is left out, so the resumed run tries it again.
+                bool isFinished = (result.status == FileStatus::anonymized)
+                        || (result.status == FileStatus::clean)
+                        || (result.status == FileStatus::unrecognized);
+                if (m_journal.isOpen() && isFinished && !m_journal.add(getEntryKey(result.path)))
+                    throw std::runtime_error("Unable to write to journal file: " + m_journalFileName);
+            }
+            catch (std::exception const &ex)
+            {
+                result.error = ex.what();
+                result.status = FileStatus::failed;
+                m_stats.increment(Stats::Counter::failed);
+
+                /// Stop handing out new files after an error, a watch carries on with the next one.
+                if (!m_watch)
+                {
+                    failed = true;
+                    entries.cancel();
+                }
+            }
+
+            result.output = out.str();
+            std::lock_guard<std::mutex> lock(resultsMutex);
+
+            /// A watch never ends, so each file is reported as soon as it's done.
+            /// Rewritten files come back as clean, those are only reported in verbose mode.
+            if (m_watch)
+            {
+                if (m_verboseMode || (result.status != FileStatus::clean))
+                {
+                    std::cout << result.output << std::flush;
+                    if (!result.error.empty())
+                        std::cerr << result.error << std::endl;
+                }
             }
-            /// Only add files from the root of each specified folder.
             else
             {
-                for (auto &entry: traverseDirectory(dir))
-                    if (isValidFile(entry))
-                        entries.push_back(entry.path());
+                results.push_back(std::move(result));
             }
+            result = ProcessResult();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < jobs; ++i)
+        workers.emplace_back(worker);
+
+    for (auto &thread: workers)
+        thread.join();
+
+    /// Sort the files in alphabetical order.
+    std::sort(std::begin(results), std::end(results),
+              [](const ProcessResult &lhs, const ProcessResult &rhs) { return lhs.path < rhs.path; });
+
+    if (results.size() > 0)
+        std::cout << (m_checkOnly ? "Checking " : "Anonymizing ") << results.size() << " File(s):" << std::endl;
+
+    for (const auto &result: results)
+    {
+        std::cout << result.output;
+        if (!result.error.empty())
+            std::cerr << result.error << std::endl;
+    }
+
+    auto countStatus = [&results](FileStatus status) {
+        return std::count_if(std::begin(results), std::end(results),
+                             [status](const ProcessResult &result) { return result.status == status; });
+    };
+
+    m_leakingCount = static_cast<std::size_t>(countStatus(FileStatus::leaking));
+    if (m_checkOnly && (results.size() > 0))
+    {
+        std::cout << "Clean: " << countStatus(FileStatus::clean)
+                  << ", Leaking: " << m_leakingCount
+                  << ", Unrecognized: " << countStatus(FileStatus::unrecognized) << std::endl;
+    }
+
+    return !failed;
+}
+
+AFKPexAnon::FileStatus AFKPexAnon::processFile(const bf::path &entry, PexPool &pool, std::ostream &out,
+                                               FileHash &hash)
+{
+    /// Check if the file is a recognized type.
+    /// The original data stays in the mapped view, only the strings are copied.
+    PexView view;
+    PexPool::Pointer pexOrig;
+    {
+        Stats::StageTimer detection(m_stats, Stats::Stage::detection);
+        view.open(entry.string());
+        detection.addBytes(view.getFileSize());
+        pexOrig = pool.acquire(view);
+        if (pexOrig && !pexOrig->readHeaderStrings(view))
+            pexOrig = nullptr;
+    }
+
+    if (!pexOrig)
+    {
+        out << "Unrecognized file type: " << entry << std::endl;
+        return FileStatus::unrecognized;
+    }
+
+    /// Nothing would change, don't bother rewriting it.
+    if (m_anonymizer.isAnonymized(*pexOrig) && !m_anonymizer.needsDataRewrite(view, pool.getWorkspace()))
+    {
+        if (m_cache.isOpen())
+        {
+            hash.value = XxHash64::hash(view.getFileData(), view.getFileSize());
+            hash.isKnown = true;
+        }
+        out << "Already anonymized: " << entry << std::endl;
+        return FileStatus::clean;
+    }
+
+    /// Once the header is masked the names are unknown, so only files seen for the first time are scanned.
+    PexNameScanner nameScanner;
+    std::size_t nameCount = 0;
+    if (!m_anonymizer.isAnonymized(*pexOrig))
+    {
+        Stats::StageTimer scan(m_stats, Stats::Stage::scan, view.getDataSize());
+        nameCount = m_anonymizer.scanNames(view, nameScanner);
+    }
+    bool isMaskingNames = m_maskNames && (nameCount > 0);
+
+    if (m_backupFiles)
+        backupEntry(entry, view.getFileSize(), out);
+
+    out << entry << std::endl;
+    if (m_verboseMode)
+        out << *pexOrig << std::endl;
+    if (nameCount > 0)
+        out << "User or machine name found in the data: " << std::dec << nameCount << " time(s)" << std::endl;
+
+    /// Stripping the debug info or compacting the strings changes the size of the data,
+    /// so it needs a full rewrite.
+    if (m_inPlace && !m_stripDebug && !m_compactStrings && !isMaskingNames)
+    {
+        std::size_t headerStringsSize = view.getHeaderStringsSize();
+        view.close();
+        {
+            Stats::StageTimer write(m_stats, Stats::Stage::write, headerStringsSize);
+            if (anonymizeInPlace(entry, *pexOrig, pool))
+                return FileStatus::anonymized;
         }
 
-        /// Sort the files in alphabetical order.
-        std::sort(std::begin(entries), std::end(entries));
+        /// The names changed size, the whole file has to be rewritten.
+        if (!view.open(entry.string()))
+            throw std::runtime_error("Unable to read file: " + entry.string());
+    }
+
+    /// Clean up the temporary file left behind by an interrupted run.
+    if (m_journal.isOpen())
+    {
+        bf::path tempPath = entry;
+        tempPath.replace_extension(defaultTempExtension);
+        bf::remove(tempPath);
+    }
+
+    /// Create a temporary working file in case there's an error.
+    bool hasTempFile;
+    {
+        Stats::StageTimer tempCopy(m_stats, Stats::Stage::tempCopy, view.getFileSize());
+        hasTempFile = backupAndChangeExt(entry, defaultTempExtension);
+    }
 
-        if (entries.size() > 0)
-            std::cout << "Anonymizing " << entries.size() << " File(s):" << std::endl;
+    if (hasTempFile)
+    {
+        bf::path tempPath = entry;
+        tempPath.replace_extension(defaultTempExtension);
+        /// The temp file is a copy of the original, so it's the same game.
+        PexPool::Pointer pexDest = pool.acquire(pexOrig->getPexHeader());
+        {
+            Stats::StageTimer read(m_stats, Stats::Stage::read, view.getFileSize());
+            ifstream destFile(tempPath.string(), std::ios::binary);
+            if (pexDest && !pexDest->read(destFile))
+                pexDest = nullptr;
+        }
 
-        for (bf::path &entry: entries)
+        if (pexDest)
         {
-            /// Check if the file is a recognized type.
-            std::unique_ptr<PexBase> pexOrig;
+            m_anonymizer.anonymize(*pexDest);
+
+            bool isRewritten = m_stripDebug || m_compactStrings || isMaskingNames;
+            if (isRewritten)
             {
-                ifstream entryFile(entry.string(), std::ios::binary);
-                pexOrig = fileformats::pex::PexFactory::createUniquePex(entryFile);
-                if (pexOrig)
-                    pexOrig->read(entryFile);
+                Stats::StageTimer rewrite(m_stats, Stats::Stage::rewrite, pexDest->getData().size());
+                m_anonymizer.rewriteData(entry.string(), *pexDest, isMaskingNames ? &nameScanner : nullptr,
+                                         nameCount, pool.getWorkspace(), out);
             }
 
-            if (pexOrig)
+            /// Write out the changes to the temp file.
+            std::size_t destSize = pexDest->getHeaderStringsSize() + pexDest->getData().size();
             {
-                if (m_backupFiles)
+                Stats::StageTimer write(m_stats, Stats::Stage::write, destSize);
+                ofstream destFile(tempPath.string(), std::ios::binary | std::ios::trunc);
+                if (!pexDest->write(destFile))
                 {
-                    bf::path backupPath = entry;
-                    backupPath.replace_extension(m_backupExtension);
-
-                    if (m_verboseMode)
-                        std::cout << "Creating backup file: " << backupPath.string() << std::endl;
+                    /// Failed to write out to the temp file properly. Attemp to clean up.
+                    destFile.close();
+                    bf::remove(tempPath);
+                    throw std::runtime_error("Unable to write to temporary file: " + tempPath.string());
+                }
+            }
 
-                    if (!createBackupFile(entry))
-                        throw std::runtime_error("Unable to create backup file: " + backupPath.string());
+            /// Read the temp file back in and compare the data to the original.
+            /// By default the data is only hashed while it streams in, a byte by byte compare
+            /// reads it into its own object, so the rewritten data doesn't need a copy.
+            PexPool::Pointer pexCheck = pool.acquire(pexOrig->getPexHeader());
+            uint64_t destHash = 0;
+            uint64_t destDataSize = 0;
+            {
+                Stats::StageTimer readBack(m_stats, Stats::Stage::readBack, destSize);
+                ifstream destFile(tempPath.string(), std::ios::binary);
+                bool isRead = false;
+                if (pexCheck && m_compareBytes)
+                {
+                    isRead = pexCheck->read(destFile);
+                    destDataSize = pexCheck->getData().size();
+                }
+                else if (pexCheck && pexCheck->readHeaderStrings(destFile))
+                {
+                    std::vector<uint8_t> &buffer = pool.getWorkspace().buffer;
+                    buffer.resize(validationBlockSize);
+                    isRead = XxHash64::hash(destFile, reinterpret_cast<char*>(buffer.data()), buffer.size(),
+                                            destHash, destDataSize);
                 }
 
-                std::cout << entry << std::endl;
-                if (m_verboseMode)
-                    std::cout << *pexOrig << std::endl;
+                if (!isRead)
+                {
+                    /// something bad happened.
+                    /// Failed to read the temp file properly. Attemp to clean up.
+                    destFile.close();
+                    bf::remove(tempPath);
+                    throw std::runtime_error("Unable to read temporary file: " + tempPath.string());
+                }
+            }
 
-                /// Create a temporary working file in case there's an error.
-                if (backupAndChangeExt(entry, defaultTempExtension))
+            /// Validate the data after the header and swap files if it's valid.
+            const uint8_t *expectedData = isRewritten ? pexDest->getData().data() : view.getData();
+            std::size_t expectedSize = isRewritten ? pexDest->getData().size() : view.getDataSize();
+            bool isValid;
+            {
+                Stats::StageTimer compare(m_stats, Stats::Stage::compare, expectedSize);
+                isValid = (pexOrig->getPexHeader() == pexCheck->getPexHeader())
+                        && (expectedSize == destDataSize);
+                if (isValid && m_compareBytes)
                 {
-                    bf::path tempPath = entry;
-                    tempPath.replace_extension(defaultTempExtension);
-                    std::unique_ptr<PexBase> pexDest;
-                    {
-                        ifstream destFile(tempPath.string(), std::ios::binary);
-                        pexDest = PexFactory::createUniquePex(destFile);
-                        if (pexDest)
-                            pexDest->read(destFile);
-                    }
-
-                    if (pexDest)
-                    {
-                        /// Fill the machine name with mask characters.
-                        pexDest->setMachineName(std::string(pexDest->getMachineName().size(), m_mask));
-                        /// Fill the user name with mask characters.
-                        pexDest->setUserName(std::string(pexDest->getUserName().size(), m_mask));
-
-                        /// Strip the path from script names in fallout 4 pex's.
-                        /// No idea why Bethesda in their infinte wisdom decided to add the path from the
-                        /// temporary folder to the source file?
-                        if (pexDest->getPexHeader().gameId == keeg::common::enumToIntegral(GameID::fallout4))
-                        {
-                            pexDest->setSourceFileName(bf::path(pexDest->getSourceFileName()).filename().string());
-                        }
-
-                        /// Write out the changes to the temp file.
-                        {
-                            ofstream destFile(tempPath.string(), std::ios::binary | std::ios::trunc);
-                            if (!pexDest->write(destFile))
-                            {
-                                /// Failed to write out to the temp file properly. Attemp to clean up.
-                                destFile.close();
-                                bf::remove(tempPath);
-                                throw std::runtime_error("Unable to write to temporary file: " + tempPath.string());
-                            }
-                        }
-
-                        /// Read the temp file back in and compare the data to the original.
-                        {
-                            ifstream destFile(tempPath.string(), std::ios::binary);
-                            if (!pexDest->read(destFile))
-                            {
-                                /// something bad happened.
-                                /// Failed to read the temp file properly. Attemp to clean up.
-                                destFile.close();
-                                bf::remove(tempPath);
-                                throw std::runtime_error("Unable to read temporary file: " + tempPath.string());
-                            }
-                        }
-
-                        /// Validate the data after the header and swap files if it's valid.
-                        if ((pexOrig->getPexHeader() == pexDest->getPexHeader())
-                                && (pexOrig->getData() == pexDest->getData()))
-                        {
-                            bf::remove(entry);
-                            bf::rename(tempPath, entry);
-                        }
-                        else
-                        {
-                            bf::remove(tempPath);
-                            std::cout << "Unable to validate data skipping: " + entry.string() << std::endl;
-                        }
-                    }
-                    /// Reading in the temp file failed.
-                    else
-                    {
-                        throw std::runtime_error("Reading in the temp file: " + tempPath.string() + " failed.");
-                    }
+                    const std::vector<uint8_t> &destData = pexCheck->getData();
+                    isValid = std::equal(std::begin(destData), std::end(destData), expectedData);
                 }
-                else
+                else if (isValid)
                 {
-                    throw std::runtime_error("Unable to create temporary files");
+                    isValid = (XxHash64::hash(expectedData, expectedSize) == destHash);
                 }
             }
+
+            /// The temp file is the header strings followed by the validated data,
+            /// the sizes confirm nothing else was written.
+            if (isValid && m_cache.isOpen())
+            {
+                std::ostringstream headerStrings;
+                pexDest->writeHeaderStrings(headerStrings);
+                const std::string header = headerStrings.str();
+                XxHash64 hasher;
+                hasher.update(header.data(), header.size());
+                hasher.update(expectedData, expectedSize);
+                hash.value = hasher.digest();
+                hash.isKnown = (header.size() + expectedSize == destSize);
+            }
+
+            /// The original can't be replaced while it's still mapped.
+            view.close();
+
+            /// Renaming over the original replaces it atomically,
+            /// there's never a moment without either version of the file.
+            if (isValid)
+            {
+                replaceFile(tempPath, entry);
+                return FileStatus::anonymized;
+            }
             else
             {
-                std::cout << "Unrecognized file type: " << entry << std::endl;
+                bf::remove(tempPath);
+                out << "Unable to validate data skipping: " + entry.string() << std::endl;
+                return FileStatus::failed;
             }
         }
+        /// Reading in the temp file failed.
+        else
+        {
+            throw std::runtime_error("Reading in the temp file: " + tempPath.string() + " failed.");
+        }
     }
-    catch (std::exception const &ex)
+    else
     {
-        std::cerr << ex.what() << std::endl;
-        return EXIT_FAILURE;
+        throw std::runtime_error("Unable to create temporary files");
     }
+}
 
-    return EXIT_SUCCESS;
+AFKPexAnon::FileStatus AFKPexAnon::processFileRing(const bf::path &entry, PexPool &pool, RingWorker &worker,
+                                                   std::ostream &out, FileHash &hash)
+{
+    uint32_t mode = 0;
+    std::size_t inputSize = 0;
+    {
+        Stats::StageTimer detection(m_stats, Stats::Stage::detection);
+        if (!worker.ring.readFile(entry.string(), worker.input, inputSize, mode))
+            throw std::runtime_error("Unable to read file: " + entry.string());
+        detection.addBytes(inputSize);
+    }
+
+    /// Quoted, the same as the paths in the rest of the output.
+    std::ostringstream name;
+    name << entry;
+
+    PexAnonymizer::Status status;
+    {
+        Stats::StageTimer rewrite(m_stats, Stats::Stage::rewrite, inputSize);
+        status = m_anonymizer.anonymize(name.str(), worker.input.data(), inputSize,
+                                        worker.output, pool, out);
+    }
+
+    switch (status) {
+    case PexAnonymizer::Status::anonymized:
+        break;
+    case PexAnonymizer::Status::clean:
+        if (m_cache.isOpen())
+        {
+            hash.value = XxHash64::hash(worker.input.data(), inputSize);
+            hash.isKnown = true;
+        }
+        if (!m_verboseMode)
+            out << "Already anonymized: " << entry << std::endl;
+        return FileStatus::clean;
+    case PexAnonymizer::Status::unrecognized:
+        return FileStatus::unrecognized;
+    case PexAnonymizer::Status::failed:
+    default:
+        return FileStatus::failed;
+    }
+
+    if (m_backupFiles)
+        backupEntry(entry, inputSize, out);
+
+    /// The new file is written and read back in one submission, with the permissions of the original.
+    bf::path tempPath = entry;
+    tempPath.replace_extension(defaultTempExtension);
+    {
+        Stats::StageTimer write(m_stats, Stats::Stage::write, worker.output.size());
+        if (!worker.ring.writeFile(tempPath.string(), worker.output, mode, &worker.readBack))
+        {
+            bf::remove(tempPath);
+            throw std::runtime_error("Unable to write to temporary file: " + tempPath.string());
+        }
+    }
+
+    bool isValid;
+    {
+        Stats::StageTimer compare(m_stats, Stats::Stage::compare, worker.output.size());
+        isValid = (worker.readBack == worker.output);
+    }
+
+    if (!isValid)
+    {
+        bf::remove(tempPath);
+        out << "Unable to validate data skipping: " + entry.string() << std::endl;
+        return FileStatus::failed;
+    }
+
+    Stats::StageTimer replace(m_stats, Stats::Stage::replace);
+    if (!worker.ring.rename(tempPath.string(), entry.string()))
+    {
+        bf::remove(tempPath);
+        throw std::runtime_error("Unable to replace file: " + entry.string());
+    }
+
+    /// Same as replaceFile, the rename is on the disk before the journal records the file.
+    if (m_journal.isOpen() && !syncFolder(entry.parent_path().string()))
+        throw std::runtime_error("Unable to sync folder: " + entry.parent_path().string());
+
+    if (m_cache.isOpen())
+    {
+        hash.value = XxHash64::hash(worker.output.data(), worker.output.size());
+        hash.isKnown = true;
+    }
+    return FileStatus::anonymized;
 }
 
-bool AFKPexAnon::isValidFile(bf::directory_entry const &entry)
+bool AFKPexAnon::processStream(std::istream &in, std::ostream &out, std::ostream &log)
 {
-    try
+    PexPool pool;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> result;
+
+    /// A single script is only written out once it's complete, a failed one writes nothing.
+    if (!m_records)
     {
-        auto it = std::find(std::begin(m_validExtensions),
-                            std::end(m_validExtensions),
-                            entry.path().extension().string());
+        {
+            Stats::StageTimer read(m_stats, Stats::Stage::read);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            read.addBytes(data.size());
+        }
 
-        return bf::is_regular_file(entry)
-                && !bf::is_other(entry)
-                && (it != std::end(m_validExtensions));
+        FileStatus status = processRecord("<stdin>", data, result, pool, log);
+        if ((status != FileStatus::anonymized) && (status != FileStatus::clean))
+            return false;
+
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        out.flush();
+        return static_cast<bool>(out);
     }
-    catch (std::exception const &ex)
+
+    /// Each record is a little endian uint32_t size followed by the script, and goes out the same way.
+    /// Records that aren't scripts are passed through, so the stream stays in step with its source.
+    for (std::size_t recordIndex = 0; ; ++recordIndex)
     {
-        std::cerr << ex.what() << std::endl;
+        const std::string name = "<record " + std::to_string(recordIndex) + ">";
+        uint32_t size = 0;
+        {
+            Stats::StageTimer read(m_stats, Stats::Stage::read);
+            if (!ki::readPODType<uint32_t>(in, size))
+            {
+                if (in.gcount() == 0)
+                    break;
+
+                log << "Truncated record size: " << name << std::endl;
+                return false;
+            }
+
+            size = ke::little_to_native(size);
+            if (size > maxRecordSize)
+            {
+                log << "Record too large: " << name << " " << size << " bytes" << std::endl;
+                return false;
+            }
+
+            data.resize(size);
+            in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+            if (static_cast<std::size_t>(in.gcount()) != size)
+            {
+                log << "Truncated record: " << name << std::endl;
+                return false;
+            }
+            read.addBytes(sizeof(size) + size);
+        }
+
+        if (processRecord(name, data, result, pool, log) == FileStatus::failed)
+            return false;
+
+        Stats::StageTimer write(m_stats, Stats::Stage::write, sizeof(size) + data.size());
+        ki::writePODType<uint32_t>(out, ke::native_to_little(static_cast<uint32_t>(data.size())));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out)
+        {
+            log << "Unable to write: " << name << std::endl;
+            return false;
+        }
+    }
+
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+AFKPexAnon::FileStatus AFKPexAnon::processRecord(const std::string &name, std::vector<uint8_t> &data,
+                                                 std::vector<uint8_t> &result, PexPool &pool, std::ostream &log)
+{
+    Stats::StageTimer fileTimer(m_stats, Stats::Stage::file);
+    m_stats.increment(Stats::Counter::found);
+
+    FileStatus status;
+    {
+        Stats::StageTimer rewrite(m_stats, Stats::Stage::rewrite, data.size());
+        switch (m_anonymizer.anonymize(name, data.data(), data.size(), result, pool, log)) {
+        case PexAnonymizer::Status::anonymized:
+            data.swap(result);
+            status = FileStatus::anonymized;
+            break;
+        case PexAnonymizer::Status::clean:
+            status = FileStatus::clean;
+            break;
+        case PexAnonymizer::Status::unrecognized:
+            status = FileStatus::unrecognized;
+            break;
+        case PexAnonymizer::Status::failed:
+        default:
+            status = FileStatus::failed;
+            break;
+        }
+    }
+
+    m_stats.increment(getCounter(status));
+    return status;
+}
+
+AFKPexAnon::FileStatus AFKPexAnon::processArchive(const bf::path &entry, PexPool &pool, std::ostream &out)
+{
+    /// Only the directory is read up front, the files are streamed through one at a time.
+    std::unique_ptr<Archive> archive;
+    ifstream archiveFile(entry.string(), std::ios::binary);
+    {
+        Stats::StageTimer detection(m_stats, Stats::Stage::detection);
+        archive = ArchiveFactory::createUniqueArchive(archiveFile);
+        if (archive && !archive->readDirectory(archiveFile))
+        {
+            out << "Unsupported archive: " << entry << " " << archive->getLastError() << std::endl;
+            return FileStatus::unrecognized;
+        }
+    }
+
+    if (!archive)
+    {
+        out << "Unrecognized file type: " << entry << std::endl;
+        return FileStatus::unrecognized;
+    }
+
+    /// The extension is appended, so it can't collide with the temp file of a script next to it.
+    bf::path tempPath = entry.string() + defaultTempExtension;
+    std::uintmax_t archiveSize = bf::file_size(entry);
+
+    std::ostringstream scriptsOut;
+    auto isScript = [this](const std::string &name) {
+        return boost::algorithm::iends_with(name, defaultPexExtension);
+    };
+    /// Messages of scripts that failed are kept apart, they're printed even without --verbose.
+    std::ostringstream failedOut;
+    std::size_t failedScripts = 0;
+    std::vector<uint8_t> scriptBuffer;
+    auto anonymizeScript = [this, &pool, &scriptsOut, &failedOut, &failedScripts, &scriptBuffer]
+            (const std::string &name, std::vector<uint8_t> &data) {
+        std::ostringstream scriptOut;
+        PexAnonymizer::Status status = m_anonymizer.anonymize(name, data.data(), data.size(), scriptBuffer, pool, scriptOut);
+        if (status == PexAnonymizer::Status::failed)
+        {
+            ++failedScripts;
+            failedOut << scriptOut.str();
+            return false;
+        }
+
+        scriptsOut << scriptOut.str();
+        if (status != PexAnonymizer::Status::anonymized)
+            return false;
+
+        data.swap(scriptBuffer);
+        return true;
+    };
+
+    ArchiveRewriteResult result;
+    bool isRewritten;
+    {
+        Stats::StageTimer rewrite(m_stats, Stats::Stage::rewrite, archiveSize);
+        ofstream tempFile(tempPath.string(), std::ios::binary | std::ios::trunc);
+        isRewritten = tempFile && archive->rewrite(archiveFile, tempFile, isScript, anonymizeScript, result);
+        tempFile.close();
+        isRewritten = isRewritten && tempFile;
+    }
+
+    if (!isRewritten)
+    {
+        bf::remove(tempPath);
+        out << "Unable to rewrite archive skipping: " << entry.string() << " " << archive->getLastError() << std::endl;
+        return FileStatus::failed;
+    }
+
+    /// A script that can't be anonymized would ship with the names, so the archive is left as is.
+    if (failedScripts > 0)
+    {
+        bf::remove(tempPath);
+        out << failedOut.str();
+        out << "Unable to anonymize " << std::dec << failedScripts << " of " << result.handled
+            << " scripts skipping: " << entry.string() << std::endl;
+        return FileStatus::failed;
+    }
+
+    if (result.changed == 0)
+    {
+        bf::remove(tempPath);
+        if (result.skipped > 0)
+            out << "Scripts in an unsupported compression left as is: " << entry << " " << std::dec << result.skipped << std::endl;
+        else
+            out << "Already anonymized: " << entry << std::endl;
+        if (m_verboseMode)
+            out << scriptsOut.str();
+        return FileStatus::clean;
+    }
+
+    if (m_backupFiles)
+        backupEntry(entry, archiveSize, out);
+
+    out << entry << std::endl;
+    out << scriptsOut.str();
+    out << "Scripts anonymized: " << std::dec << result.changed << " of " << result.handled << std::endl;
+    if (result.skipped > 0)
+        out << "Scripts in an unsupported compression left as is: " << std::dec << result.skipped << std::endl;
+
+    /// Every script was already validated on its own, check the new directory reads back the same.
+    bool isValid;
+    {
+        Stats::StageTimer readBack(m_stats, Stats::Stage::readBack);
+        ifstream tempFile(tempPath.string(), std::ios::binary);
+        std::unique_ptr<Archive> archiveCheck = ArchiveFactory::createUniqueArchive(tempFile);
+        isValid = archiveCheck && archiveCheck->readDirectory(tempFile)
+                && (archiveCheck->getFileNames() == archive->getFileNames());
+    }
+
+    archiveFile.close();
+    if (isValid)
+    {
+        replaceFile(tempPath, entry);
+        return FileStatus::anonymized;
+    }
+    else
+    {
+        bf::remove(tempPath);
+        out << "Unable to validate data skipping: " + entry.string() << std::endl;
+        return FileStatus::failed;
+    }
+}
+
+AFKPexAnon::FileStatus AFKPexAnon::checkFile(const bf::path &entry, PexPool &pool, std::ostream &out)
+{
+    /// Only the header and the names are read, the data is never touched.
+    PexView view;
+    PexPool::Pointer pex;
+    {
+        Stats::StageTimer detection(m_stats, Stats::Stage::detection);
+        view.openHeader(entry.string(), pool.getWorkspace().buffer);
+        detection.addBytes(view.getFileSize());
+        pex = pool.acquire(view);
+        if (pex && !pex->readHeaderStrings(view))
+            pex = nullptr;
+    }
+
+    if (!pex)
+    {
+        out << "Unrecognized file type: " << entry << std::endl;
+        return FileStatus::unrecognized;
+    }
+
+    if (m_anonymizer.isAnonymized(*pex))
+    {
+        if (m_verboseMode)
+            out << "Clean: " << entry << std::endl;
+        return FileStatus::clean;
+    }
+
+    out << "Leaking: " << entry << std::endl;
+    if (m_verboseMode)
+        out << *pex << std::endl;
+    return FileStatus::leaking;
+}
+
+bool AFKPexAnon::anonymizeInPlace(const bf::path &entry, PexBase &pex, PexPool &pool)
+{
+    const std::size_t headerSize = pex.getHeaderStringsSize();
+    const std::string sourceFileName = pex.getSourceFileName();
+    m_anonymizer.anonymize(pex);
+
+    /// Only the strings in front of the data get overwritten, so they can't change size.
+    if (pex.getSourceFileName().size() != sourceFileName.size())
+    {
+        pex.setSourceFileName(sourceFileName);
         return false;
     }
+
+    {
+        fstream entryFile(entry.string(), std::ios::binary | std::ios::in | std::ios::out);
+        if (!entryFile || (pex.writeHeaderStrings(entryFile) != headerSize))
+            throw std::runtime_error("Unable to update file in place: " + entry.string());
+    }
+
+    /// Read the strings back in and compare them to what was written.
+    PexPool::Pointer pexDest = pool.acquire(pex.getPexHeader());
+    {
+        ifstream entryFile(entry.string(), std::ios::binary);
+        if (pexDest && !pexDest->readHeaderStrings(entryFile))
+            pexDest = nullptr;
+    }
+
+    if (!pexDest
+            || !(pex.getPexHeader() == pexDest->getPexHeader())
+            || (pex.getSourceFileName() != pexDest->getSourceFileName())
+            || (pex.getUserName() != pexDest->getUserName())
+            || (pex.getMachineName() != pexDest->getMachineName()))
+    {
+        throw std::runtime_error("Unable to validate file updated in place: " + entry.string());
+    }
+
+    return true;
+}
+
+std::string AFKPexAnon::getEntryKey(const bf::path &entry) const
+{
+    return bf::absolute(entry).string();
+}
+
+std::string AFKPexAnon::getCacheSettings() const
+{
+    /// Files cached with other settings have to be processed again.
+    return std::string("mask=") + m_mask
+            + " strip-debug=" + (m_stripDebug ? "1" : "0")
+            + " compact-strings=" + (m_compactStrings ? "1" : "0")
+            + " mask-names=" + (m_maskNames ? "1" : "0");
+}
+
+bool AFKPexAnon::isCached(const bf::path &entry, bool compareContent)
+{
+    FileCache::FileInfo info;
+    if (!FileCache::getFileInfo(entry.string(), info))
+        return false;
+
+    const std::string key = getEntryKey(entry);
+    FileCache::Record record;
+    if (!m_cache.find(key, record))
+        return false;
+
+    if (record.info == info)
+        return true;
+
+    /// Hashing means reading the whole file, only worth it if the size is the same.
+    uint64_t hash;
+    if (!compareContent || (record.info.size != info.size)
+            || !FileCache::hashFile(entry.string(), hash) || (hash != record.hash))
+    {
+        return false;
+    }
+
+    record.info = info;
+    m_cache.update(key, record);
+    return true;
+}
+
+void AFKPexAnon::updateCache(const bf::path &entry, FileStatus status, const FileHash &hash)
+{
+    FileCache::Record record;
+    switch (status) {
+    case FileStatus::anonymized:
+    case FileStatus::clean:
+        record.status = FileCache::Status::clean;
+        break;
+    case FileStatus::unrecognized:
+        record.status = FileCache::Status::unrecognized;
+        break;
+    default:
+        /// Try again next time.
+        m_cache.erase(getEntryKey(entry));
+        return;
+    }
+
+    /// Only files that weren't already in memory are read again.
+    record.hash = hash.value;
+    if (FileCache::getFileInfo(entry.string(), record.info)
+            && (hash.isKnown || FileCache::hashFile(entry.string(), record.hash)))
+    {
+        m_cache.update(getEntryKey(entry), record);
+    }
+}
+
+Stats::Counter AFKPexAnon::getCounter(FileStatus status)
+{
+    switch (status) {
+    case FileStatus::anonymized:
+        return Stats::Counter::anonymized;
+    case FileStatus::clean:
+        return Stats::Counter::alreadyAnonymized;
+    case FileStatus::unrecognized:
+        return Stats::Counter::unrecognized;
+    case FileStatus::leaking:
+        return Stats::Counter::leaking;
+    case FileStatus::failed:
+    default:
+        return Stats::Counter::failed;
+    }
+}
+
+std::size_t AFKPexAnon::getJobCount() const
+{
+    return (m_jobs > 0) ? m_jobs : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void AFKPexAnon::compileFileFilter()
+{
+    for (const auto &extension: m_validExtensions)
+        m_fileFilter.include(extension);
+
+    /// Checking only reads the header of loose scripts.
+    if (m_archives && !m_checkOnly)
+    {
+        for (const auto &extension: archiveExtensions)
+            m_fileFilter.include(extension);
+    }
+
+    for (const auto &pattern: m_excludePatterns)
+        m_fileFilter.exclude(pattern);
+}
+
+bool AFKPexAnon::isArchive(const bf::path &entry) const
+{
+    const std::string extension = entry.extension().string();
+    return std::any_of(std::begin(archiveExtensions), std::end(archiveExtensions),
+                       [&extension](const std::string &archiveExtension) {
+                           return boost::algorithm::iequals(extension, archiveExtension);
+                       });
+}
+
+void AFKPexAnon::replaceFile(const bf::path &tempPath, const bf::path &entry)
+{
+    Stats::StageTimer replace(m_stats, Stats::Stage::replace);
+
+    /// Otherwise a crash could leave the rename on the disk without the data.
+    if (!syncFile(tempPath.string()))
+    {
+        bf::remove(tempPath);
+        throw std::runtime_error("Unable to sync temporary file: " + tempPath.string());
+    }
+
+    bf::rename(tempPath, entry);
+
+    /// The journal is about to record the file as done, so the rename has to be on the disk first.
+    if (m_journal.isOpen() && !syncFolder(entry.parent_path().string()))
+        throw std::runtime_error("Unable to sync folder: " + entry.parent_path().string());
+}
+
+void AFKPexAnon::backupEntry(const bf::path &entry, std::uintmax_t size, std::ostream &out)
+{
+    bf::path backupPath = entry;
+    backupPath.replace_extension(m_backupExtension);
+
+    /// An interrupted run may have already replaced the file, keep the original backup.
+    if (m_journal.isOpen() && bf::exists(backupPath))
+    {
+        if (m_verboseMode)
+            out << "Keeping existing backup file: " << backupPath.string() << std::endl;
+    }
+    else
+    {
+        if (m_verboseMode)
+            out << "Creating backup file: " << backupPath.string() << std::endl;
+
+        Stats::StageTimer backupCopy(m_stats, Stats::Stage::backupCopy, size);
+        /// The original is replaced later, the backup can't be lost to a crash after that.
+        if (!createBackupFile(entry) || !syncFile(backupPath.string()))
+            throw std::runtime_error("Unable to create backup file: " + backupPath.string());
+    }
 }
 
 bool AFKPexAnon::backupAndChangeExt(const boost::filesystem::path &filePath, const string &ext)
@@ -231,7 +1313,10 @@ bool AFKPexAnon::backupAndChangeExt(const boost::filesystem::path &filePath, con
     {
         bf::path backupFile = filePath;
         backupFile.replace_extension(ext);
-        bf::copy_file(filePath, backupFile, bf::copy_option::fail_if_exists);
+
+        /// Cloned where the file system allows it, so the copy costs no data I/O.
+        if (copyFile(filePath.string(), backupFile.string()) == CopyMethod::reflink)
+            m_stats.increment(Stats::Counter::reflinked);
         return true;
     }
     catch (const std::exception &ex)
@@ -332,6 +1417,127 @@ bool AFKPexAnon::processProgramOptions()
                 ->zero_tokens(),
             "Recursively process all subfolders."
         )
+        (
+            "exclude",
+            bpo::value<std::vector<std::string>>(&m_excludePatterns)
+                ->multitoken()
+                ->composing(),
+            "Skip files and folders whose name matches a pattern, * and ? are wildcards."
+        )
+        (
+            "files-from",
+            bpo::value<std::string>(&m_filesFromName),
+            "Process the files listed in a file, one per line or NUL separated, instead of searching the source folders. Use - for stdin."
+        )
+        (
+            "watch",
+            bpo::value<bool>(&m_watch)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Keep running and process each script as soon as it's written to the source folders, on Linux."
+        )
+        (
+            "archives",
+            bpo::value<bool>(&m_archives)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Also process the scripts inside .ba2 and .bsa archives."
+        )
+        (
+            "stdin",
+            bpo::value<bool>(&m_stdin)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Read a script from stdin and write the anonymized script to stdout."
+        )
+        (
+            "records",
+            bpo::value<bool>(&m_records)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "With --stdin, the stream is a series of scripts, each prefixed with its size as a little endian uint32."
+        )
+        (
+            "check",
+            bpo::value<bool>(&m_checkOnly)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Only report files that still have real names, without changing anything."
+        )
+        (
+            "in-place,i",
+            bpo::value<bool>(&m_inPlace)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Overwrite the names in place instead of rewriting each file."
+        )
+        (
+            "jobs,j",
+            bpo::value<std::size_t>(&m_jobs)
+                ->default_value(1),
+            "Number of files to process at the same time, 0 uses all cores."
+        )
+        (
+            "journal",
+            bpo::value<std::string>(&m_journalFileName),
+            "Record finished files in a journal, so an interrupted run can be resumed."
+        )
+        (
+            "cache",
+            bpo::value<std::string>(&m_cacheFileName),
+            "Remember processed files, so unchanged files are skipped on the next run."
+        )
+        (
+            "mask-names",
+            bpo::value<bool>(&m_maskNames)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Also mask the user and machine names in the strings after the header."
+        )
+        (
+            "compare-bytes",
+            bpo::value<bool>(&m_compareBytes)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Validate rewritten files byte by byte instead of by hash."
+        )
+        (
+            "io-uring",
+            bpo::value<bool>(&m_ioUring)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Read and write the files through io_uring, on Linux builds with CONFIG+=io_uring."
+        )
+        (
+            "stats",
+            bpo::value<std::string>(&m_statsFileName),
+            "Write stage timings and counters to a file, as CSV if it ends in .csv, else JSON. Use - for the console."
+        )
+        (
+            "strip-debug",
+            bpo::value<bool>(&m_stripDebug)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Remove the debug info, including the source modification time."
+        )
+        (
+            "compact-strings",
+            bpo::value<bool>(&m_compactStrings)
+                ->default_value(false)
+                ->implicit_value(true)
+                ->zero_tokens(),
+            "Remove unused and duplicate strings from the string table."
+        )
         (
             "verbose",
             bpo::value<bool>(&m_verboseMode)
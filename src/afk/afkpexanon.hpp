@@ -22,12 +22,22 @@
 #ifndef AFKPEXANON_HPP
 #define AFKPEXANON_HPP
 
+#include <chrono>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/range/iterator_range.hpp>
+#include <afk/concurrentqueue.hpp>
+#include <afk/filecache.hpp>
+#include <afk/filenamefilter.hpp>
+#include <afk/ioring.hpp>
+#include <afk/journal.hpp>
+#include <afk/pexanonymizer.hpp>
+#include <afk/stats.hpp>
+#include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexpool.hpp>
 #include "version.hpp"
 
 namespace afk {
@@ -40,40 +50,84 @@ public:
     virtual int run();
 
 protected:
-    template <typename T>
-    boost::iterator_range<boost::filesystem::recursive_directory_iterator> traverseDirectoryRecursive(T const &dir)
+    /// Outcome of processing a single file.
+    enum class FileStatus
     {
-        boost::filesystem::recursive_directory_iterator l;
-        try
-        {
-            boost::filesystem::recursive_directory_iterator f(dir);
-            return boost::make_iterator_range(f, l);
-        }
-        catch(std::exception const &ex)
-        {
-            std::cerr << ex.what() << std::endl;
-            return boost::make_iterator_range(l, l);
-        }
-    }
-
-    template <typename T>
-    boost::iterator_range<boost::filesystem::directory_iterator> traverseDirectory(T const &dir)
+        anonymized,
+        clean,
+        unrecognized,
+        failed,
+        leaking,    // Found by --check, still has real names.
+    };
+
+    /// Buffered console output of a single file.
+    struct ProcessResult
     {
-        boost::filesystem::directory_iterator l;
-        try
-        {
-            boost::filesystem::directory_iterator f(dir);
-            return boost::make_iterator_range(f, l);
-        }
-        catch (std::exception const &ex)
-        {
-            std::cerr << ex.what() << std::endl;
-            return boost::make_iterator_range(l, l);
-        }
-    }
-
-    bool isValidFile(boost::filesystem::directory_entry const &entry);
-
+        boost::filesystem::path path;
+        std::string output;
+        std::string error;
+        FileStatus status = FileStatus::failed;
+    };
+
+    /// File I/O of a worker through io_uring, the buffers are reused from one file to the next.
+    struct RingWorker
+    {
+        IoRing ring;
+        /// Only grows, each file is read into the start of it.
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+        std::vector<uint8_t> readBack;
+    };
+
+    /// Hash of a file as it was left on the disk, known when the whole file was in memory
+    /// anyway, so the cache doesn't have to read it again.
+    struct FileHash
+    {
+        bool isKnown = false;
+        uint64_t value = 0;
+    };
+
+    std::size_t getJobCount() const;
+    /// Builds m_fileFilter from the extension and exclude options.
+    void compileFileFilter();
+    bool isArchive(const boost::filesystem::path &entry) const;
+    std::string getEntryKey(const boost::filesystem::path &entry) const;
+    std::string getCacheSettings() const;
+    bool isCached(const boost::filesystem::path &entry, bool compareContent);
+    void updateCache(const boost::filesystem::path &entry, FileStatus status, const FileHash &hash);
+    static Stats::Counter getCounter(FileStatus status);
+
+    virtual void findFiles(ConcurrentQueue<boost::filesystem::path> &entries);
+    /// Queues the scripts written to the source folders, until stopped with Ctrl+C.
+    virtual void watchFiles(ConcurrentQueue<boost::filesystem::path> &entries);
+    /// Passes each path of a newline or NUL separated list to the callback, until it returns false.
+    bool readFileList(std::istream &list, const std::function<bool(const std::string &)> &callback);
+    virtual bool processFiles(ConcurrentQueue<boost::filesystem::path> &entries);
+    /// The pool belongs to the calling worker, it keeps the buffers of earlier files.
+    /// Reads only the header and names, and reports whether the names are masked.
+    virtual FileStatus checkFile(const boost::filesystem::path &entry, fileformats::pex::PexPool &pool,
+                                 std::ostream &out);
+    virtual FileStatus processFile(const boost::filesystem::path &entry, fileformats::pex::PexPool &pool,
+                                   std::ostream &out, FileHash &hash);
+    /// Filters a script, or a stream of length prefixed scripts, from in to out.
+    /// Messages go to log, since out carries the data.
+    virtual bool processStream(std::istream &in, std::ostream &out, std::ostream &log);
+    /// Anonymizes one script of the stream, data is swapped with result when it changes.
+    FileStatus processRecord(const std::string &name, std::vector<uint8_t> &data, std::vector<uint8_t> &result,
+                             fileformats::pex::PexPool &pool, std::ostream &log);
+    /// Same as processFile, but reads, writes and renames through io_uring,
+    /// with the whole file in memory instead of a temporary copy.
+    virtual FileStatus processFileRing(const boost::filesystem::path &entry, fileformats::pex::PexPool &pool,
+                                       RingWorker &worker, std::ostream &out, FileHash &hash);
+    /// Rewrites a .ba2 or .bsa archive with every script inside it anonymized.
+    virtual FileStatus processArchive(const boost::filesystem::path &entry, fileformats::pex::PexPool &pool,
+                                      std::ostream &out);
+    bool anonymizeInPlace(const boost::filesystem::path &entry, fileformats::pex::PexBase &pex,
+                          fileformats::pex::PexPool &pool);
+
+    /// Renames the temporary file over the original, once its data is on the disk.
+    void replaceFile(const boost::filesystem::path &tempPath, const boost::filesystem::path &entry);
+    void backupEntry(const boost::filesystem::path &entry, std::uintmax_t size, std::ostream &out);
     bool backupAndChangeExt(const boost::filesystem::path &filePath, const std::string &ext);
     bool createBackupFile(const boost::filesystem::path &filePath);
     bool removeBackupFile(const boost::filesystem::path &filePath);
@@ -91,6 +145,16 @@ protected:
     const std::string defaultCurrentFolder{"."};
     const std::string defaultConfigFileName{"afkpexanon.cfg"};
     const std::string defaultTempExtension{".tmp"};
+    const std::vector<std::string> archiveExtensions{".ba2", ".bsa"};
+    /// Largest record accepted by --records, anything bigger is a corrupted stream.
+    const std::size_t maxRecordSize{256 * 1024 * 1024};
+    const std::size_t defaultQueueCapacity{4096};
+    const std::size_t validationBlockSize{64 * 1024};
+    /// Quiet time a watched file needs before it's processed, it may still be written to.
+    const std::chrono::milliseconds watchDebounce{50};
+    const std::chrono::milliseconds watchPollInterval{250};
+    /// Exit code of --check when any file still has real names.
+    const int leakingExitCode{2};
     const std::string afkPexAnonDesString{"AFKPexAnon PEX Anonymizer V"+version::VERSION_STRING};
 
     /// Boost Program Options
@@ -103,6 +167,20 @@ protected:
 
     /// Valid extensions of files to process.
     std::vector<std::string> m_validExtensions;
+    /// Patterns of file and folder names to skip.
+    std::vector<std::string> m_excludePatterns;
+    /// Matches the names of the files to process, compiled from the lists above.
+    FileNameFilter m_fileFilter;
+    /// Name of the file listing the files to process, empty when searching the source folders.
+    std::string m_filesFromName;
+    /// Set when a source folder couldn't be searched.
+    bool m_isSearchFailed = false;
+    /// Set when the list couldn't be read or a listed file is missing.
+    bool m_isListIncomplete = false;
+    /// Keep processing files as they're written switch.
+    bool m_watch;
+    /// Set when the source folders couldn't be watched.
+    bool m_isWatchFailed = false;
     /// List of source root folders to search.
     std::vector<std::string> m_sourceFolders;
     /// Extension to use for backup files.
@@ -115,6 +193,44 @@ protected:
     char m_mask;
     /// Recurse through sub-folders switch.
     bool m_recursiveFolders;
+    /// Process the scripts inside archives switch.
+    bool m_archives;
+    /// Filter stdin to stdout instead of searching folders switch.
+    bool m_stdin;
+    /// The stream is made of length prefixed scripts switch.
+    bool m_records;
+    /// Report files with real names without changing anything switch.
+    bool m_checkOnly;
+    /// Files found with real names by the last check.
+    std::size_t m_leakingCount = 0;
+    /// Overwrite the names in place switch.
+    bool m_inPlace;
+    /// Strip debug info switch.
+    bool m_stripDebug;
+    /// Compact the string table switch.
+    bool m_compactStrings;
+    /// Mask the names found in the strings after the header switch.
+    bool m_maskNames;
+    /// Validate by comparing every byte instead of hashes switch.
+    bool m_compareBytes;
+    /// Use io_uring for the file I/O switch.
+    bool m_ioUring;
+    /// Number of files to process at the same time.
+    std::size_t m_jobs;
+    /// Name of the journal file, empty when not resuming runs.
+    std::string m_journalFileName;
+    /// Files already processed by an interrupted run.
+    Journal m_journal;
+    /// Name of the cache file, empty when every file is processed.
+    std::string m_cacheFileName;
+    /// Files processed by earlier runs.
+    FileCache m_cache;
+    /// Name of the stats report, empty when not collecting stats.
+    std::string m_statsFileName;
+    /// Timings and counters of the run.
+    Stats m_stats;
+    /// Anonymizes the files, set up from the options above.
+    PexAnonymizer m_anonymizer;
     /// Show help switch.
     bool m_showHelp;
     /// Show version switch.
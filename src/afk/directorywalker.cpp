@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/directorywalker.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace afk {
+
+namespace bf = boost::filesystem;
+
+DirectoryWalker::DirectoryWalker(std::size_t threadCount) : m_threadCount(std::max<std::size_t>(1, threadCount))
+{ }
+
+bool DirectoryWalker::walk(const std::string &root, bool recursive, const Filter &filter, const Callback &callback,
+                           const Filter &folderFilter)
+{
+    m_hasErrors = false;
+
+    if (isNative())
+        return walkNative(root, recursive, filter, callback, folderFilter);
+
+    return walkPortable(root, recursive, filter, callback, folderFilter);
+}
+
+bool DirectoryWalker::walkPortable(const std::string &root, bool recursive, const Filter &filter,
+                                   const Callback &callback, const Filter &folderFilter)
+{
+    auto visit = [&filter, &callback](const bf::directory_entry &entry)
+    {
+        const std::string fileName = entry.path().filename().string();
+        if (filter(fileName) && bf::is_regular_file(entry.status()))
+            return callback(entry.path().string());
+        return true;
+    };
+
+    try
+    {
+        if (recursive)
+        {
+            for (bf::recursive_directory_iterator it(root), end; it != end; ++it)
+            {
+                if (folderFilter && bf::is_directory(it->symlink_status())
+                        && !folderFilter(it->path().filename().string()))
+                {
+                    it.no_push();
+                    continue;
+                }
+
+                if (!visit(*it))
+                    return false;
+            }
+        }
+        else
+        {
+            for (bf::directory_iterator it(root), end; it != end; ++it)
+                if (!visit(*it))
+                    return false;
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        m_hasErrors = true;
+    }
+
+    return true;
+}
+
+#ifdef __linux__
+
+namespace {
+
+/// Layout the kernel fills in, glibc only has a wrapper for it since 2.30.
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+const std::size_t readBufferSize = 64 * 1024;
+
+/// Folders waiting to be read, shared by the walking threads.
+struct WalkState
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::string> folders;
+    std::size_t active = 0;
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> failed{false};
+    std::mutex callbackMutex;
+};
+
+enum class EntryType { file, folder, other };
+
+EntryType getEntryType(int folderFd, const char *name, unsigned char type)
+{
+    switch (type) {
+    case DT_REG:
+        return EntryType::file;
+    case DT_DIR:
+        return EntryType::folder;
+    case DT_LNK:
+    case DT_UNKNOWN:
+        break;
+    default:
+        return EntryType::other;
+    }
+
+    /// Some file systems don't fill in d_type, and links need their target.
+    struct stat status;
+    if (::fstatat(folderFd, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+        return EntryType::other;
+
+    if (S_ISLNK(status.st_mode))
+    {
+        return ((::fstatat(folderFd, name, &status, 0) == 0) && S_ISREG(status.st_mode))
+                ? EntryType::file : EntryType::other;
+    }
+
+    if (S_ISDIR(status.st_mode))
+        return EntryType::folder;
+
+    return S_ISREG(status.st_mode) ? EntryType::file : EntryType::other;
+}
+
+void readFolder(const std::string &folder, bool recursive, const DirectoryWalker::Filter &filter,
+                const DirectoryWalker::Callback &callback, const DirectoryWalker::Filter &folderFilter,
+                std::vector<char> &buffer, WalkState &state)
+{
+    int folderFd = ::open(folder.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (folderFd < 0)
+    {
+        std::cerr << "Unable to read folder: " << folder << ": " << std::strerror(errno) << std::endl;
+        state.failed = true;
+        return;
+    }
+
+    const std::string prefix = (folder.back() == '/') ? folder : folder + '/';
+    std::vector<std::string> subfolders;
+
+    while (!state.stopped)
+    {
+        long size = ::syscall(SYS_getdents64, folderFd, buffer.data(), buffer.size());
+        if (size < 0)
+        {
+            std::cerr << "Unable to read folder: " << folder << ": " << std::strerror(errno) << std::endl;
+            state.failed = true;
+        }
+        if (size <= 0)
+            break;
+
+        for (long offset = 0; (offset < size) && !state.stopped; )
+        {
+            const LinuxDirent64 *entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += entry->d_reclen;
+
+            boost::string_view name(entry->d_name);
+            if ((name == ".") || (name == ".."))
+                continue;
+
+            /// The names decide first, only entries that may be wanted get a stat.
+            const bool mayBeFolder = recursive && ((entry->d_type == DT_DIR) || (entry->d_type == DT_UNKNOWN));
+            const bool fileWanted = (entry->d_type != DT_DIR) && filter(name);
+            const bool folderWanted = mayBeFolder && (!folderFilter || folderFilter(name));
+            if (!fileWanted && !folderWanted)
+                continue;
+
+            switch (getEntryType(folderFd, entry->d_name, entry->d_type)) {
+            case EntryType::file:
+                if (fileWanted)
+                {
+                    std::lock_guard<std::mutex> lock(state.callbackMutex);
+                    if (!state.stopped && !callback(prefix + entry->d_name))
+                        state.stopped = true;
+                }
+                break;
+            case EntryType::folder:
+                if (folderWanted)
+                    subfolders.push_back(prefix + entry->d_name);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    ::close(folderFd);
+
+    if (!subfolders.empty())
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        std::move(std::begin(subfolders), std::end(subfolders), std::back_inserter(state.folders));
+        state.changed.notify_all();
+    }
+}
+
+} // anonymous namespace
+
+bool DirectoryWalker::walkNative(const std::string &root, bool recursive, const Filter &filter,
+                                 const Callback &callback, const Filter &folderFilter)
+{
+    WalkState state;
+    state.folders.push_back(root);
+
+    /// Each thread takes the next folder, and hands the subfolders it finds back to the others.
+    auto worker = [&]()
+    {
+        std::vector<char> buffer(readBufferSize);
+        for (;;)
+        {
+            std::string folder;
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                state.changed.wait(lock, [&state]() {
+                    return state.stopped || !state.folders.empty() || (state.active == 0);
+                });
+                if (state.stopped || state.folders.empty())
+                    break;
+
+                folder = std::move(state.folders.back());
+                state.folders.pop_back();
+                ++state.active;
+            }
+
+            readFolder(folder, recursive, filter, callback, folderFilter, buffer, state);
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            --state.active;
+            if (state.stopped || ((state.active == 0) && state.folders.empty()))
+                state.changed.notify_all();
+        }
+    };
+
+    /// A single folder doesn't need any threads.
+    std::size_t threadCount = recursive ? m_threadCount : 1;
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto &thread: threads)
+        thread.join();
+
+    m_hasErrors = state.failed;
+    return !state.stopped;
+}
+
+bool DirectoryWalker::isNative()
+{
+    return true;
+}
+
+#else
+
+bool DirectoryWalker::walkNative(const std::string &root, bool recursive, const Filter &filter,
+                                 const Callback &callback, const Filter &folderFilter)
+{
+    return walkPortable(root, recursive, filter, callback, folderFilter);
+}
+
+bool DirectoryWalker::isNative()
+{
+    return false;
+}
+
+#endif
+
+} // afk namespace
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef DIRECTORYWALKER_HPP
+#define DIRECTORYWALKER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+namespace afk {
+
+/// Finds the regular files in a folder tree. On Linux the folders are read with getdents64
+/// in large batches and the file type comes from d_type, so most entries never need a stat.
+/// Subfolders are read in parallel. Elsewhere it falls back to boost::filesystem on one thread.
+/// Like boost's recursive_directory_iterator, symlinks to files are followed but symlinks to
+/// folders aren't descended into.
+class DirectoryWalker
+{
+public:
+    /// Gets the name only, decides whether the callback sees the file or the folder is searched.
+    using Filter = std::function<bool(boost::string_view name)>;
+    /// Gets the full path, returns false to stop the walk. Calls never overlap.
+    using Callback = std::function<bool(const std::string &path)>;
+
+    explicit DirectoryWalker(std::size_t threadCount = 1);
+
+    /// Returns false only when the callback stopped the walk, unreadable folders are
+    /// reported to std::cerr and skipped, and hasErrors tells whether there were any.
+    /// Names are filtered before any stat, so rejected entries cost no system call.
+    bool walk(const std::string &root, bool recursive, const Filter &filter, const Callback &callback,
+              const Filter &folderFilter = Filter());
+
+    /// Whether a folder couldn't be read during the last walk.
+    inline bool hasErrors() const { return m_hasErrors; }
+
+    /// Whether the getdents64 walker is used.
+    static bool isNative();
+
+private:
+    std::size_t m_threadCount;
+    bool m_hasErrors = false;
+
+    bool walkNative(const std::string &root, bool recursive, const Filter &filter, const Callback &callback,
+                    const Filter &folderFilter);
+    bool walkPortable(const std::string &root, bool recursive, const Filter &filter, const Callback &callback,
+                      const Filter &folderFilter);
+};
+
+} // afk namespace
+
+#endif // DIRECTORYWALKER_HPP
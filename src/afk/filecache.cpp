@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "filecache.hpp"
+#include "xxhash64.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace afk {
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+const std::string cacheFileSignature{"AFKPexAnon cache 2"};
+/// The first version hashed with FNV-1a, its records can't be compared and are dropped.
+const std::string oldCacheFileSignature{"AFKPexAnon cache 1"};
+
+} // anonymous namespace
+
+bool FileCache::load(const std::string &fileName, const std::string &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fileName = fileName;
+    m_settings = settings;
+    m_records.clear();
+
+    try
+    {
+        std::ifstream cacheFile(m_fileName);
+        /// No cache yet, it's created on save.
+        if (!cacheFile)
+            return true;
+
+        std::string line;
+        if (std::getline(cacheFile, line) && (line == oldCacheFileSignature))
+            return true;
+        if (!cacheFile || (line != cacheFileSignature))
+            return false;
+
+        if (!std::getline(cacheFile, line) || (line != m_settings))
+            return true;
+
+        /// size mtime id hash status path
+        while (std::getline(cacheFile, line))
+        {
+            std::istringstream fields(line);
+            Record record;
+            unsigned status;
+            std::string entry;
+
+            fields >> record.info.size >> record.info.modifiedTime >> record.info.fileId
+                    >> std::hex >> record.hash >> std::dec >> status;
+            fields.get();
+            if (fields && std::getline(fields, entry) && !entry.empty())
+            {
+                record.status = static_cast<Status>(status);
+                m_records[entry] = record;
+            }
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool FileCache::save() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try
+    {
+        bf::path tempPath = m_fileName + ".tmp";
+        {
+            std::ofstream cacheFile(tempPath.string(), std::ios::trunc);
+            cacheFile << cacheFileSignature << '\n' << m_settings << '\n';
+            for (const auto &record: m_records)
+            {
+                cacheFile << record.second.info.size << ' '
+                          << record.second.info.modifiedTime << ' '
+                          << record.second.info.fileId << ' '
+                          << std::hex << record.second.hash << std::dec << ' '
+                          << static_cast<unsigned>(record.second.status) << ' '
+                          << record.first << '\n';
+            }
+
+            if (!cacheFile.flush())
+                return false;
+        }
+
+        bf::rename(tempPath, m_fileName);
+        return true;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+}
+
+bool FileCache::find(const std::string &entry, Record &record) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_records.find(entry);
+    if (it == std::end(m_records))
+        return false;
+
+    record = it->second;
+    return true;
+}
+
+void FileCache::update(const std::string &entry, const Record &record)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_records[entry] = record;
+}
+
+void FileCache::erase(const std::string &entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_records.erase(entry);
+}
+
+bool FileCache::getFileInfo(const std::string &fileName, FileInfo &info)
+{
+    struct stat status;
+    if (::stat(fileName.c_str(), &status) != 0)
+        return false;
+
+    /// Nanoseconds where available, the compiler rewrites scripts within the same second.
+    info.size = static_cast<uint64_t>(status.st_size);
+#if defined(__linux__)
+    info.modifiedTime = static_cast<int64_t>(status.st_mtim.tv_sec) * INT64_C(1000000000) + status.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    info.modifiedTime = static_cast<int64_t>(status.st_mtimespec.tv_sec) * INT64_C(1000000000) + status.st_mtimespec.tv_nsec;
+#else
+    info.modifiedTime = static_cast<int64_t>(status.st_mtime) * INT64_C(1000000000);
+#endif
+    info.fileId = static_cast<uint64_t>(status.st_ino);
+    return true;
+}
+
+bool FileCache::hashFile(const std::string &fileName, uint64_t &hash)
+{
+    try
+    {
+        /// Empty files can't be mapped.
+        if (bf::file_size(fileName) == 0)
+        {
+            hash = XxHash64::hash(nullptr, 0);
+            return true;
+        }
+
+        boost::iostreams::mapped_file_source file(fileName);
+        hash = XxHash64::hash(file.data(), file.size());
+        return true;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+}
+
+bool operator ==(const FileCache::FileInfo &lhs, const FileCache::FileInfo &rhs)
+{
+    return  (lhs.size == rhs.size) &&
+            (lhs.modifiedTime == rhs.modifiedTime) &&
+            (lhs.fileId == rhs.fileId);
+}
+
+} // afk namespace
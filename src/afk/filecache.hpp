@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace afk {
+
+/// Persistent index of files that were already handled, so unchanged files
+/// can be skipped on later runs without opening them.
+class FileCache
+{
+public:
+    enum class Status : uint8_t
+    {
+        clean           = 0,    // Anonymized by this or an earlier run.
+        unrecognized    = 1,    // Not a known pex file.
+    };
+
+    /// File identity as reported by the file system.
+    struct FileInfo
+    {
+        uint64_t size;
+        int64_t  modifiedTime;  // nanoseconds since the epoch.
+        uint64_t fileId;        // inode, always 0 on Windows.
+    };
+
+    struct Record
+    {
+        FileInfo info;
+        uint64_t hash;
+        Status status;
+    };
+
+    FileCache() { }
+
+    /// Records made with different settings are dropped.
+    bool load(const std::string &fileName, const std::string &settings);
+    /// Writes to a temporary file first and renames it over the cache.
+    bool save() const;
+    inline bool isOpen() const { return !m_fileName.empty(); }
+
+    bool find(const std::string &entry, Record &record) const;
+    void update(const std::string &entry, const Record &record);
+    void erase(const std::string &entry);
+
+    /// A single stat call, returns false if the file doesn't exist.
+    static bool getFileInfo(const std::string &fileName, FileInfo &info);
+    /// XxHash64 of the whole file, the same as XxHash64::hash over its bytes.
+    static bool hashFile(const std::string &fileName, uint64_t &hash);
+
+private:
+    std::string m_fileName;
+    std::string m_settings;
+    std::unordered_map<std::string, Record> m_records;
+    mutable std::mutex m_mutex;
+};
+
+bool operator ==(const FileCache::FileInfo &lhs, const FileCache::FileInfo &rhs);
+
+} // afk namespace
+
+#endif // FILECACHE_HPP
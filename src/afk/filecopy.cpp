@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/filecopy.hpp>
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+namespace afk {
+
+namespace bf = boost::filesystem;
+
+#ifdef __linux__
+
+namespace {
+
+/// Copies in the kernel, false when the file system can't so the caller can fall back.
+bool copyRange(int sourceFd, int destFd, off_t size)
+{
+#ifdef SYS_copy_file_range
+    for (off_t copied = 0; copied < size; )
+    {
+        /// Called through syscall, glibc only has a wrapper for it since 2.27.
+        long count = ::syscall(SYS_copy_file_range, sourceFd, nullptr, destFd, nullptr,
+                               static_cast<std::size_t>(size - copied), 0u);
+        if ((count < 0) && (errno == EINTR))
+            continue;
+        if (count <= 0)
+            return false;
+        copied += count;
+    }
+    return true;
+#else
+    (void)sourceFd;
+    (void)destFd;
+    (void)size;
+    return false;
+#endif
+}
+
+/// Makes the copy without reading it into user space, false when the file system can't.
+bool copyInKernel(const std::string &from, const std::string &to, CopyMethod &method)
+{
+    int sourceFd = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd < 0)
+        return false;
+
+    struct stat status;
+    if ((::fstat(sourceFd, &status) != 0) || !S_ISREG(status.st_mode))
+    {
+        ::close(sourceFd);
+        return false;
+    }
+
+    int destFd = ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, status.st_mode & 07777);
+    if (destFd < 0)
+    {
+        ::close(sourceFd);
+        return false;
+    }
+
+    bool isCopied = true;
+    if (::ioctl(destFd, FICLONE, sourceFd) == 0)
+        method = CopyMethod::reflink;
+    else if (copyRange(sourceFd, destFd, status.st_size))
+        method = CopyMethod::copyRange;
+    else
+        isCopied = false;
+
+    if (::close(destFd) != 0)
+        isCopied = false;
+    ::close(sourceFd);
+
+    /// Leave nothing behind for the fallback, it won't overwrite.
+    if (!isCopied)
+        ::unlink(to.c_str());
+
+    return isCopied;
+}
+
+} // anonymous namespace
+
+#endif
+
+CopyMethod copyFile(const std::string &from, const std::string &to)
+{
+#ifdef __linux__
+    CopyMethod method;
+    if (copyInKernel(from, to, method))
+        return method;
+#endif
+
+    /// Also reports the errors, such as a destination that already exists.
+    bf::copy_file(from, to, bf::copy_option::fail_if_exists);
+    return CopyMethod::full;
+}
+
+#ifdef _WIN32
+
+bool syncFile(const std::string &fileName)
+{
+    int fd = ::_open(fileName.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0)
+        return false;
+
+    bool isSynced = (::_commit(fd) == 0);
+    ::_close(fd);
+    return isSynced;
+}
+
+bool syncFolder(const std::string &)
+{
+    return true;
+}
+
+#else
+
+bool syncFile(const std::string &fileName)
+{
+    /// Any descriptor of the file flushes the data written through the others.
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    bool isSynced = (::fsync(fd) == 0);
+    ::close(fd);
+    return isSynced;
+}
+
+bool syncFolder(const std::string &folderName)
+{
+    int fd = ::open(folderName.empty() ? "." : folderName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    bool isSynced = (::fsync(fd) == 0);
+    ::close(fd);
+    return isSynced;
+}
+
+#endif
+
+} // afk namespace
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef FILECOPY_HPP
+#define FILECOPY_HPP
+
+#include <string>
+
+namespace afk {
+
+/// How copyFile made the copy.
+enum class CopyMethod
+{
+    reflink,    // Shares the extents of the source, Btrfs and XFS.
+    copyRange,  // Copied by the kernel, without passing through user space.
+    full,       // Read and written by boost::filesystem.
+};
+
+/// Copies a file, failing if the destination exists. On Linux the copy is first cloned
+/// with FICLONE, so it costs a metadata update instead of a data copy, then made with
+/// copy_file_range. Where neither works it falls back to boost::filesystem::copy_file.
+/// Throws boost::filesystem::filesystem_error on failure.
+CopyMethod copyFile(const std::string &from, const std::string &to);
+
+/// Waits until the data of the file is on the disk, so it can safely be renamed over another.
+bool syncFile(const std::string &fileName);
+/// Waits until the entries of the folder, such as a rename, are on the disk. Does nothing on Windows.
+bool syncFolder(const std::string &folderName);
+
+} // afk namespace
+
+#endif // FILECOPY_HPP
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/archive/archive.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <exception>
+
+namespace afk { namespace fileformats { namespace archive {
+
+namespace bio = boost::iostreams;
+
+bool Archive::fail(const std::string &error)
+{
+    m_lastError = error;
+    return false;
+}
+
+bool Archive::readAt(std::istream &instream, uint64_t offset, std::size_t size, std::vector<uint8_t> &data)
+{
+    /// Checked first, a corrupted size would otherwise allocate up to 4 GB.
+    instream.clear();
+    instream.seekg(0, std::ios::end);
+    uint64_t streamSize = static_cast<uint64_t>(instream.tellg());
+    if ((offset > streamSize) || (size > streamSize - offset))
+        return false;
+
+    data.resize(size);
+    instream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    instream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+    return static_cast<std::size_t>(instream.gcount()) == size;
+}
+
+namespace {
+
+/// Runs the data through a zlib filter, the filters only work on char buffers.
+template <typename Filter>
+bool filter(Filter zlibFilter, const uint8_t *data, std::size_t size, std::size_t reserve, std::vector<uint8_t> &out)
+{
+    try
+    {
+        std::string result;
+        result.reserve(reserve);
+        {
+            bio::filtering_ostream stream;
+            stream.push(zlibFilter);
+            stream.push(bio::back_inserter(result));
+            stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            stream.reset();
+        }
+
+        out.assign(std::begin(result), std::end(result));
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        /// Corrupted data, the caller reports it.
+        return false;
+    }
+}
+
+} // anonymous namespace
+
+bool Archive::inflate(const uint8_t *data, std::size_t size, std::size_t originalSize, std::vector<uint8_t> &out)
+{
+    return filter(bio::zlib_decompressor(), data, size, originalSize, out) && (out.size() == originalSize);
+}
+
+bool Archive::deflate(const std::vector<uint8_t> &data, std::vector<uint8_t> &out)
+{
+    return filter(bio::zlib_compressor(), data.data(), data.size(), data.size(), out);
+}
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace afk { namespace fileformats { namespace archive {
+
+struct ArchiveRewriteResult
+{
+    std::size_t handled = 0;    // Files passed to the handler.
+    std::size_t changed = 0;    // Files the handler changed.
+    std::size_t skipped = 0;    // Files accepted by the filter but stored in an unsupported way.
+};
+
+/// Base class of the Bethesda archive formats. Only the directory is kept in memory,
+/// the files are read, handled and written one at a time.
+class Archive
+{
+public:
+    /// Decides from the full path inside the archive whether a file is handled.
+    using EntryFilter = std::function<bool(const std::string &name)>;
+    /// Gets the uncompressed data of a file, returns true if it changed the data.
+    using EntryHandler = std::function<bool(const std::string &name, std::vector<uint8_t> &data)>;
+
+    /// Reads the header, the file records and the names, but not the file data.
+    virtual bool readDirectory(std::istream &instream) = 0;
+
+    /// Writes a copy of the archive read by readDirectory, with the files accepted by the
+    /// filter passed through the handler. Other files are copied without decompressing them.
+    /// The output stream must be seekable, the directory is written again at the end.
+    virtual bool rewrite(std::istream &instream, std::ostream &outstream,
+                         const EntryFilter &filter, const EntryHandler &handler,
+                         ArchiveRewriteResult &result) = 0;
+
+    inline std::size_t getFileCount() const { return m_names.size(); }
+    inline const std::vector<std::string>& getFileNames() const { return m_names; }
+    inline std::string getLastError() const { return m_lastError; }
+
+    inline virtual ~Archive() { }
+
+protected:
+    /// Full path of every file, in the order of the file records.
+    std::vector<std::string> m_names;
+    std::string m_lastError;
+
+    /// Scratch buffers reused for every file.
+    std::vector<uint8_t> m_rawData;
+    std::vector<uint8_t> m_data;
+
+    Archive() { }
+
+    bool fail(const std::string &error);
+
+    /// Both formats are little endian, fields are read and patched straight in the directory bytes.
+    static inline uint16_t getUInt16(const uint8_t *data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    static inline uint32_t getUInt32(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    static inline uint64_t getUInt64(const uint8_t *data)
+    {
+        return static_cast<uint64_t>(getUInt32(data)) | (static_cast<uint64_t>(getUInt32(data + 4)) << 32);
+    }
+
+    static inline void putUInt32(uint8_t *data, uint32_t value)
+    {
+        for (std::size_t i = 0; i < sizeof(value); ++i)
+            data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    static inline void putUInt64(uint8_t *data, uint64_t value)
+    {
+        for (std::size_t i = 0; i < sizeof(value); ++i)
+            data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    /// Reads size bytes at offset into data.
+    static bool readAt(std::istream &instream, uint64_t offset, std::size_t size, std::vector<uint8_t> &data);
+
+    /// zlib streams, as used by Fallout 4 and Skyrim archives.
+    static bool inflate(const uint8_t *data, std::size_t size, std::size_t originalSize, std::vector<uint8_t> &out);
+    static bool deflate(const std::vector<uint8_t> &data, std::vector<uint8_t> &out);
+};
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // ARCHIVE_HPP
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/archive/archivefactory.hpp>
+#include <afk/fileformats/archive/ba2archive.hpp>
+#include <afk/fileformats/archive/bsaarchive.hpp>
+
+namespace afk { namespace fileformats { namespace archive {
+
+std::unique_ptr<Archive> ArchiveFactory::createUniqueArchive(std::istream &instream)
+{
+    uint8_t magic[4] = { };
+    instream.clear();
+    instream.seekg(0, std::ios::beg);
+    instream.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    if (static_cast<std::size_t>(instream.gcount()) != sizeof(magic))
+        return nullptr;
+
+    if (Ba2Archive::isBa2(magic, sizeof(magic)))
+        return std::make_unique<Ba2Archive>();
+    if (BsaArchive::isBsa(magic, sizeof(magic)))
+        return std::make_unique<BsaArchive>();
+
+    return nullptr;
+}
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
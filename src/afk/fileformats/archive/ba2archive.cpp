@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/archive/ba2archive.hpp>
+#include <cstring>
+#include <limits>
+
+namespace afk { namespace fileformats { namespace archive {
+
+namespace {
+
+/// Header
+///   00 char[4]  BTDX
+///   04 uint32   version, 1 or the 7 and 8 of the later updates
+///   08 char[4]  GNRL or DX10
+///   0C uint32   file count
+///   10 uint64   name table offset
+/// General file record
+///   00 uint32   name hash
+///   04 char[4]  extension
+///   08 uint32   directory hash
+///   0C uint32   flags
+///   10 uint64   data offset
+///   18 uint32   packed size, 0 when stored uncompressed
+///   1C uint32   unpacked size
+///   20 uint32   BAADF00D
+const std::size_t fileCountOffset = 0x0C;
+const std::size_t nameTableOffsetOffset = 0x10;
+const std::size_t dataOffsetOffset = 0x10;
+const std::size_t packedSizeOffset = 0x18;
+const std::size_t unpackedSizeOffset = 0x1C;
+
+} // anonymous namespace
+
+bool Ba2Archive::isBa2(const uint8_t *data, std::size_t size)
+{
+    return (size >= 4) && (std::memcmp(data, "BTDX", 4) == 0);
+}
+
+bool Ba2Archive::readDirectory(std::istream &instream)
+{
+    m_names.clear();
+    if (!readAt(instream, 0, headerSize, m_directory) || !isBa2(m_directory.data(), m_directory.size()))
+        return fail("Not a BA2 archive");
+
+    if (std::memcmp(m_directory.data() + 8, "GNRL", 4) != 0)
+        return fail("Only general BA2 archives are supported, texture archives don't hold scripts");
+
+    uint32_t version = getUInt32(m_directory.data() + 4);
+    if ((version != 1) && (version != 7) && (version != 8))
+        return fail("Unsupported BA2 version: " + std::to_string(version));
+
+    uint32_t fileCount = getUInt32(m_directory.data() + fileCountOffset);
+    uint64_t nameTableOffset = getUInt64(m_directory.data() + nameTableOffsetOffset);
+
+    instream.clear();
+    instream.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(instream.tellg());
+
+    std::vector<uint8_t> records;
+    if ((headerSize + uint64_t(fileCount) * recordSize > fileSize)
+            || !readAt(instream, headerSize, fileCount * recordSize, records))
+        return fail("Truncated BA2 file records");
+    m_directory.insert(std::end(m_directory), std::begin(records), std::end(records));
+
+    /// The name table runs to the end of the file.
+    if ((nameTableOffset < m_directory.size()) || (nameTableOffset > fileSize)
+            || !readAt(instream, nameTableOffset, static_cast<std::size_t>(fileSize - nameTableOffset), m_nameTable))
+        return fail("Invalid BA2 name table offset");
+
+    std::size_t offset = 0;
+    for (uint32_t i = 0; i < fileCount; ++i)
+    {
+        if (offset + sizeof(uint16_t) > m_nameTable.size())
+            return fail("Truncated BA2 name table");
+
+        std::size_t length = getUInt16(m_nameTable.data() + offset);
+        offset += sizeof(uint16_t);
+        if (offset + length > m_nameTable.size())
+            return fail("Truncated BA2 name table");
+
+        m_names.emplace_back(reinterpret_cast<const char*>(m_nameTable.data() + offset), length);
+        offset += length;
+    }
+
+    return true;
+}
+
+bool Ba2Archive::rewrite(std::istream &instream, std::ostream &outstream,
+                         const EntryFilter &filter, const EntryHandler &handler,
+                         ArchiveRewriteResult &result)
+{
+    result = ArchiveRewriteResult();
+
+    /// Written twice, first to make room and again once the offsets are known.
+    std::vector<uint8_t> directory = m_directory;
+    outstream.seekp(0, std::ios::beg);
+    outstream.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size()));
+
+    for (std::size_t i = 0; i < m_names.size(); ++i)
+    {
+        uint8_t *record = directory.data() + headerSize + i * recordSize;
+        uint32_t packedSize = getUInt32(record + packedSizeOffset);
+        uint32_t unpackedSize = getUInt32(record + unpackedSizeOffset);
+        uint32_t storedSize = packedSize ? packedSize : unpackedSize;
+
+        if (!readAt(instream, getUInt64(record + dataOffsetOffset), storedSize, m_rawData))
+            return fail("Truncated BA2 file data: " + m_names[i]);
+
+        if (filter(m_names[i]))
+        {
+            if (packedSize)
+            {
+                if (!inflate(m_rawData.data(), m_rawData.size(), unpackedSize, m_data))
+                    return fail("Corrupted BA2 file data: " + m_names[i]);
+            }
+            else
+            {
+                m_data = m_rawData;
+            }
+
+            ++result.handled;
+            if (handler(m_names[i], m_data))
+            {
+                ++result.changed;
+                if (m_data.size() > std::numeric_limits<uint32_t>::max())
+                    return fail("File too large for a BA2 archive: " + m_names[i]);
+
+                unpackedSize = static_cast<uint32_t>(m_data.size());
+                if (packedSize)
+                {
+                    if (!deflate(m_data, m_rawData))
+                        return fail("Unable to compress: " + m_names[i]);
+                    packedSize = static_cast<uint32_t>(m_rawData.size());
+                }
+                else
+                {
+                    m_rawData.swap(m_data);
+                }
+            }
+        }
+
+        putUInt64(record + dataOffsetOffset, static_cast<uint64_t>(outstream.tellp()));
+        putUInt32(record + packedSizeOffset, packedSize);
+        putUInt32(record + unpackedSizeOffset, unpackedSize);
+        outstream.write(reinterpret_cast<const char*>(m_rawData.data()), static_cast<std::streamsize>(m_rawData.size()));
+    }
+
+    putUInt64(directory.data() + nameTableOffsetOffset, static_cast<uint64_t>(outstream.tellp()));
+    outstream.write(reinterpret_cast<const char*>(m_nameTable.data()), static_cast<std::streamsize>(m_nameTable.size()));
+
+    outstream.seekp(0, std::ios::beg);
+    outstream.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size()));
+    outstream.seekp(0, std::ios::end);
+
+    if (!outstream)
+        return fail("Unable to write the BA2 archive");
+
+    return true;
+}
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef BA2ARCHIVE_HPP
+#define BA2ARCHIVE_HPP
+
+#include <afk/fileformats/archive/archive.hpp>
+
+namespace afk { namespace fileformats { namespace archive {
+
+/// Fallout 4 general archive (BTDX, GNRL), the kind that holds scripts.
+/// Texture archives (DX10) are reported as unsupported.
+class Ba2Archive : public Archive
+{
+public:
+    Ba2Archive() { }
+
+    virtual bool readDirectory(std::istream &instream) override;
+    virtual bool rewrite(std::istream &instream, std::ostream &outstream,
+                         const EntryFilter &filter, const EntryHandler &handler,
+                         ArchiveRewriteResult &result) override;
+
+    static bool isBa2(const uint8_t *data, std::size_t size);
+
+private:
+    static const std::size_t headerSize = 24;
+    static const std::size_t recordSize = 36;
+
+    /// Header and file records, written again with the new offsets and sizes.
+    std::vector<uint8_t> m_directory;
+    /// Names at the end of the archive, copied as is.
+    std::vector<uint8_t> m_nameTable;
+};
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // BA2ARCHIVE_HPP
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/archive/bsaarchive.hpp>
+#include <cstring>
+#include <limits>
+
+namespace afk { namespace fileformats { namespace archive {
+
+namespace {
+
+/// Header
+///   00 char[4]  BSA\0
+///   04 uint32   version, 104 Skyrim, 105 Skyrim SE
+///   08 uint32   folder records offset, always 36
+///   0C uint32   archive flags
+///   10 uint32   folder count
+///   14 uint32   file count
+///   18 uint32   total length of the folder names, with their terminators
+///   1C uint32   total length of the file names, with their terminators
+///   20 uint32   content flags
+/// Folder records, 16 bytes in 104 and 24 in 105, with the file count at 08.
+/// File record blocks, one for each folder, optionally starting with the folder name
+/// as a length prefixed, null terminated string, followed by its file records
+///   00 uint64   name hash
+///   08 uint32   size, bit 30 flips the archive's compression flag for this file
+///   0C uint32   data offset from the start of the archive
+/// File names, null terminated, in the order of the file records.
+const std::size_t flagsOffset = 0x0C;
+const std::size_t folderCountOffset = 0x10;
+const std::size_t fileCountOffset = 0x14;
+const std::size_t folderNamesLengthOffset = 0x18;
+const std::size_t fileNamesLengthOffset = 0x1C;
+const std::size_t folderFileCountOffset = 0x08;
+const std::size_t sizeOffset = 0x08;
+const std::size_t dataOffsetOffset = 0x0C;
+
+const uint32_t includeFolderNames = 0x001;
+const uint32_t includeFileNames = 0x002;
+const uint32_t compressedByDefault = 0x004;
+const uint32_t embedFileNames = 0x100;
+const uint32_t xmemCodec = 0x200;
+
+const uint32_t compressionToggle = 0x40000000;
+const uint32_t sizeMask = 0x3FFFFFFF;
+
+} // anonymous namespace
+
+bool BsaArchive::isBsa(const uint8_t *data, std::size_t size)
+{
+    return (size >= 4) && (std::memcmp(data, "BSA\0", 4) == 0);
+}
+
+bool BsaArchive::readDirectory(std::istream &instream)
+{
+    m_names.clear();
+    m_recordOffsets.clear();
+
+    std::vector<uint8_t> header;
+    if (!readAt(instream, 0, headerSize, header) || !isBsa(header.data(), header.size()))
+        return fail("Not a BSA archive");
+
+    m_version = getUInt32(header.data() + 4);
+    if ((m_version != 104) && (m_version != 105))
+        return fail("Unsupported BSA version: " + std::to_string(m_version));
+
+    m_archiveFlags = getUInt32(header.data() + flagsOffset);
+    uint32_t folderCount = getUInt32(header.data() + folderCountOffset);
+    uint32_t fileCount = getUInt32(header.data() + fileCountOffset);
+    uint32_t folderNamesLength = getUInt32(header.data() + folderNamesLengthOffset);
+    uint32_t fileNamesLength = getUInt32(header.data() + fileNamesLengthOffset);
+    std::size_t folderRecordSize = (m_version == 105) ? 24 : 16;
+
+    uint64_t directorySize = headerSize + uint64_t(folderCount) * folderRecordSize + uint64_t(fileCount) * fileRecordSize;
+    if (m_archiveFlags & includeFolderNames)
+        directorySize += uint64_t(folderCount) + folderNamesLength;
+    if (m_archiveFlags & includeFileNames)
+        directorySize += fileNamesLength;
+
+    instream.clear();
+    instream.seekg(0, std::ios::end);
+    if (directorySize > static_cast<uint64_t>(instream.tellg()))
+        return fail("Truncated BSA directory");
+
+    if (!readAt(instream, 0, static_cast<std::size_t>(directorySize), m_directory))
+        return fail("Truncated BSA directory");
+
+    /// File record blocks follow the folder records, in the same order.
+    std::size_t offset = headerSize + folderCount * folderRecordSize;
+    std::vector<std::string> folderNames;
+    for (uint32_t folder = 0; folder < folderCount; ++folder)
+    {
+        uint32_t count = getUInt32(m_directory.data() + headerSize + folder * folderRecordSize + folderFileCountOffset);
+
+        std::string folderName;
+        if (m_archiveFlags & includeFolderNames)
+        {
+            if (offset >= m_directory.size())
+                return fail("Truncated BSA folder names");
+            std::size_t length = m_directory[offset];
+            if (offset + 1 + length > m_directory.size())
+                return fail("Truncated BSA folder names");
+            folderName.assign(reinterpret_cast<const char*>(m_directory.data() + offset + 1), length ? length - 1 : 0);
+            offset += 1 + length;
+        }
+
+        if (offset + uint64_t(count) * fileRecordSize > m_directory.size())
+            return fail("Truncated BSA file records");
+
+        for (uint32_t file = 0; file < count; ++file)
+        {
+            m_recordOffsets.push_back(offset);
+            folderNames.push_back(folderName);
+            offset += fileRecordSize;
+        }
+    }
+
+    if (m_recordOffsets.size() != fileCount)
+        return fail("BSA file count doesn't match the folders");
+
+    /// Longer folder names than the header says leave less room for the file names.
+    if ((m_archiveFlags & includeFileNames) && (offset + uint64_t(fileNamesLength) > m_directory.size()))
+        return fail("Truncated BSA file names");
+
+    /// Without file names nothing can be matched, every file is copied as is.
+    const char *fileNames = reinterpret_cast<const char*>(m_directory.data() + offset);
+    std::size_t fileNamesOffset = 0;
+    for (std::size_t i = 0; i < fileCount; ++i)
+    {
+        std::string fileName;
+        if (m_archiveFlags & includeFileNames)
+        {
+            const void *end = std::memchr(fileNames + fileNamesOffset, '\0', fileNamesLength - fileNamesOffset);
+            if (!end)
+                return fail("Truncated BSA file names");
+            fileName.assign(fileNames + fileNamesOffset, static_cast<const char*>(end));
+            fileNamesOffset += fileName.size() + 1;
+        }
+
+        m_names.push_back(folderNames[i].empty() ? fileName : folderNames[i] + "\\" + fileName);
+    }
+
+    return true;
+}
+
+bool BsaArchive::rewrite(std::istream &instream, std::ostream &outstream,
+                         const EntryFilter &filter, const EntryHandler &handler,
+                         ArchiveRewriteResult &result)
+{
+    result = ArchiveRewriteResult();
+
+    /// Written twice, first to make room and again once the offsets are known.
+    std::vector<uint8_t> directory = m_directory;
+    outstream.seekp(0, std::ios::beg);
+    outstream.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size()));
+
+    for (std::size_t i = 0; i < m_names.size(); ++i)
+    {
+        uint8_t *record = directory.data() + m_recordOffsets[i];
+        uint32_t size = getUInt32(record + sizeOffset);
+
+        if (!readAt(instream, getUInt32(record + dataOffsetOffset), size & sizeMask, m_rawData))
+            return fail("Truncated BSA file data: " + m_names[i]);
+
+        if (filter(m_names[i]))
+        {
+            bool isCompressed = ((m_archiveFlags & compressedByDefault) != 0) != ((size & compressionToggle) != 0);
+
+            /// The full path may be stored again in front of the data.
+            std::size_t prefixSize = 0;
+            if ((m_archiveFlags & embedFileNames) && !m_rawData.empty())
+                prefixSize = 1 + m_rawData[0];
+
+            bool isSupported = true;
+            if (isCompressed)
+            {
+                /// Skyrim SE compresses with LZ4 and Xbox archives with XMem, only zlib is supported.
+                if ((m_version == 105) || (m_archiveFlags & xmemCodec))
+                    isSupported = false;
+                else if ((prefixSize + sizeof(uint32_t) > m_rawData.size())
+                         || !inflate(m_rawData.data() + prefixSize + sizeof(uint32_t),
+                                     m_rawData.size() - prefixSize - sizeof(uint32_t),
+                                     getUInt32(m_rawData.data() + prefixSize), m_data))
+                    return fail("Corrupted BSA file data: " + m_names[i]);
+            }
+            else
+            {
+                if (prefixSize > m_rawData.size())
+                    return fail("Corrupted BSA file data: " + m_names[i]);
+                m_data.assign(std::begin(m_rawData) + prefixSize, std::end(m_rawData));
+            }
+
+            if (!isSupported)
+            {
+                ++result.skipped;
+            }
+            else
+            {
+                ++result.handled;
+                if (handler(m_names[i], m_data))
+                {
+                    ++result.changed;
+                    m_rawData.resize(prefixSize);
+                    if (isCompressed)
+                    {
+                        std::vector<uint8_t> compressed;
+                        if (!deflate(m_data, compressed))
+                            return fail("Unable to compress: " + m_names[i]);
+
+                        uint8_t originalSize[sizeof(uint32_t)];
+                        putUInt32(originalSize, static_cast<uint32_t>(m_data.size()));
+                        m_rawData.insert(std::end(m_rawData), originalSize, originalSize + sizeof(originalSize));
+                        m_rawData.insert(std::end(m_rawData), std::begin(compressed), std::end(compressed));
+                    }
+                    else
+                    {
+                        m_rawData.insert(std::end(m_rawData), std::begin(m_data), std::end(m_data));
+                    }
+
+                    if (m_rawData.size() > sizeMask)
+                        return fail("File too large for a BSA archive: " + m_names[i]);
+                    size = (size & ~sizeMask) | static_cast<uint32_t>(m_rawData.size());
+                }
+            }
+        }
+
+        uint64_t dataOffset = static_cast<uint64_t>(outstream.tellp());
+        if (dataOffset + m_rawData.size() > std::numeric_limits<uint32_t>::max())
+            return fail("BSA archive larger than 4 GB");
+
+        putUInt32(record + sizeOffset, size);
+        putUInt32(record + dataOffsetOffset, static_cast<uint32_t>(dataOffset));
+        outstream.write(reinterpret_cast<const char*>(m_rawData.data()), static_cast<std::streamsize>(m_rawData.size()));
+    }
+
+    outstream.seekp(0, std::ios::beg);
+    outstream.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size()));
+    outstream.seekp(0, std::ios::end);
+
+    if (!outstream)
+        return fail("Unable to write the BSA archive");
+
+    return true;
+}
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef BSAARCHIVE_HPP
+#define BSAARCHIVE_HPP
+
+#include <afk/fileformats/archive/archive.hpp>
+
+namespace afk { namespace fileformats { namespace archive {
+
+/// Skyrim (version 104) and Skyrim SE (version 105) archives.
+/// Compressed Skyrim SE files use LZ4, they're copied as is and counted as skipped.
+class BsaArchive : public Archive
+{
+public:
+    BsaArchive() { }
+
+    virtual bool readDirectory(std::istream &instream) override;
+    virtual bool rewrite(std::istream &instream, std::ostream &outstream,
+                         const EntryFilter &filter, const EntryHandler &handler,
+                         ArchiveRewriteResult &result) override;
+
+    static bool isBsa(const uint8_t *data, std::size_t size);
+
+private:
+    static const std::size_t headerSize = 36;
+    static const std::size_t fileRecordSize = 16;
+
+    uint32_t m_version = 0;
+    uint32_t m_archiveFlags = 0;
+    /// Everything in front of the file data, written again with the new offsets and sizes.
+    std::vector<uint8_t> m_directory;
+    /// Position of each file record in the directory.
+    std::vector<std::size_t> m_recordOffsets;
+};
+
+} // archive namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // BSAARCHIVE_HPP
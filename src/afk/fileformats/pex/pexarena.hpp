@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXARENA_HPP
+#define PEXARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Bump allocator for parsed pex nodes. Everything is released at once by reset(),
+/// which keeps the memory around so the next file doesn't allocate again.
+class PexArena
+{
+public:
+    explicit PexArena(std::size_t blockSize = defaultBlockSize) : m_blockSize(blockSize) { }
+
+    PexArena(const PexArena &) = delete;
+    PexArena & operator =(const PexArena &) = delete;
+
+    /// Uninitialized storage for count objects, nodes must be trivially destructible.
+    template <typename T>
+    T* allocate(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena nodes are never destroyed.");
+        if (count == 0)
+            return nullptr;
+
+        return static_cast<T*>(allocateBytes(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset()
+    {
+        m_block = 0;
+        m_offset = 0;
+    }
+
+    /// Total bytes reserved from the heap.
+    std::size_t capacity() const
+    {
+        std::size_t total = 0;
+        for (const auto &block: m_blocks)
+            total += block.size;
+        return total;
+    }
+
+private:
+    static const std::size_t defaultBlockSize = 64 * 1024;
+
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> data;
+        std::size_t size;
+    };
+
+    std::size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    std::size_t m_block = 0;
+    std::size_t m_offset = 0;
+
+    void* allocateBytes(std::size_t size, std::size_t alignment)
+    {
+        while (m_block < m_blocks.size())
+        {
+            Block &block = m_blocks[m_block];
+            std::size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size)
+            {
+                m_offset = offset + size;
+                return block.data.get() + offset;
+            }
+
+            ++m_block;
+            m_offset = 0;
+        }
+
+        /// Blocks come from new[], so they're aligned for any node type.
+        std::size_t blockSize = (size > m_blockSize) ? size : m_blockSize;
+        m_blocks.push_back(Block{std::unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize});
+        m_block = m_blocks.size() - 1;
+        m_offset = size;
+        return m_blocks.back().data.get();
+    }
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXARENA_HPP
@@ -20,6 +20,10 @@
  * IN THE SOFTWARE.
  */
 #include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexnamescanner.hpp>
+#include <afk/fileformats/pex/pexparser.hpp>
+#include <afk/fileformats/pex/pexpool.hpp>
+#include <afk/fileformats/pex/pexstringtable.hpp>
 #include <keeg/io/binaryreaders.hpp>
 #include <keeg/io/binarywriters.hpp>
 #include <algorithm>
@@ -54,8 +58,27 @@ void PexBase::setMachineName(const std::string &machineName)
 
 void PexBase::setData(const std::vector<uint8_t> &data)
 {
-    m_data.resize(data.size());
-    std::copy(std::begin(data), std::end(data), std::begin(m_data));
+    m_data.assign(std::begin(data), std::end(data));
+}
+
+void PexBase::setSourceFileName(std::string &&sourceFileName)
+{
+    m_sourceFileName = std::move(sourceFileName);
+}
+
+void PexBase::setUserName(std::string &&userName)
+{
+    m_userName = std::move(userName);
+}
+
+void PexBase::setMachineName(std::string &&machineName)
+{
+    m_machineName = std::move(machineName);
+}
+
+void PexBase::setData(std::vector<uint8_t> &&data)
+{
+    m_data = std::move(data);
 }
 
 bool PexBase::isPex(std::istream &instream)
@@ -88,12 +111,8 @@ std::size_t PexBase::read(std::istream &instream)
     {
         if (instream)
         {
-            if (isPex(instream))
+            if (readHeaderStrings(instream))
             {
-                status = ki::readWString(instream, m_sourceFileName, m_endianOrder);
-                status = ki::readWString(instream, m_userName, m_endianOrder);
-                status = ki::readWString(instream, m_machineName, m_endianOrder);
-
                 auto headerEndPosition = instream.tellg();
                 instream.seekg(0, std::ios::end);
                 auto fileSize = instream.tellg();
@@ -115,6 +134,53 @@ std::size_t PexBase::read(std::istream &instream)
 }
 
 std::size_t PexBase::write(std::ostream &outstream)
+{
+    std::size_t status = 0;
+    try
+    {
+        if (outstream)
+        {
+            status = writeHeaderStrings(outstream);
+            if (status)
+                status += ki::writeBytes(outstream, m_data, m_data.size());
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return 0;
+    }
+
+    return status;
+}
+
+std::size_t PexBase::readHeaderStrings(std::istream &instream)
+{
+    try
+    {
+        if (instream)
+        {
+            if (isPex(instream))
+            {
+                ki::readWString(instream, m_sourceFileName, m_endianOrder);
+                ki::readWString(instream, m_userName, m_endianOrder);
+                ki::readWString(instream, m_machineName, m_endianOrder);
+
+                if (instream)
+                    return getHeaderStringsSize();
+            }
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return 0;
+    }
+
+    return 0;
+}
+
+std::size_t PexBase::writeHeaderStrings(std::ostream &outstream)
 {
     std::size_t status = 0;
     try
@@ -128,8 +194,6 @@ std::size_t PexBase::write(std::ostream &outstream)
                 status += ki::writeWString(outstream, m_sourceFileName, m_endianOrder);
                 status += ki::writeWString(outstream, m_userName, m_endianOrder);
                 status += ki::writeWString(outstream, m_machineName, m_endianOrder);
-
-                status += ki::writeBytes(outstream, m_data, m_data.size());
             }
         }
     }
@@ -142,6 +206,129 @@ std::size_t PexBase::write(std::ostream &outstream)
     return status;
 }
 
+std::size_t PexBase::read(const PexView &view)
+{
+    if (!readHeaderStrings(view))
+        return 0;
+
+    m_data.assign(view.getData(), view.getData() + view.getDataSize());
+    return view.getFileSize();
+}
+
+std::size_t PexBase::readHeaderStrings(const PexView &view)
+{
+    if (!view.isValid() || (view.getEndianOrder() != m_endianOrder) || !isPex(view.getPexHeader()))
+        return 0;
+
+    m_header = view.getPexHeader();
+    /// Assigning in place keeps the capacity of a reused object.
+    m_sourceFileName.assign(view.getSourceFileName().data(), view.getSourceFileName().size());
+    m_userName.assign(view.getUserName().data(), view.getUserName().size());
+    m_machineName.assign(view.getMachineName().data(), view.getMachineName().size());
+
+    return view.getHeaderStringsSize();
+}
+
+std::size_t PexBase::getHeaderStringsSize() const
+{
+    /// Each string is prefixed with a uint16_t length.
+    return sizeof(PexHeader) +
+            sizeof(uint16_t) + m_sourceFileName.size() +
+            sizeof(uint16_t) + m_userName.size() +
+            sizeof(uint16_t) + m_machineName.size();
+}
+
+bool PexBase::parseData(PexArena &arena, PexScript &script) const
+{
+    return PexParser::parse(m_data.data(), m_data.size(), m_endianOrder, m_header, arena, script);
+}
+
+bool PexBase::stripDebugInfo()
+{
+    PexWorkspace workspace;
+    return stripDebugInfo(workspace);
+}
+
+bool PexBase::stripDebugInfo(PexWorkspace &workspace)
+{
+    workspace.reset();
+    PexScript script;
+    if (!parseData(workspace.arena, script))
+        return false;
+
+    if (script.debugInfo.hasDebugInfo)
+    {
+        /// Only the has debug info flag is left, set to false.
+        auto debugInfo = std::begin(m_data) + script.debugInfoSection.offset;
+        *debugInfo = 0;
+        m_data.erase(debugInfo + 1, debugInfo + script.debugInfoSection.size);
+    }
+
+    return true;
+}
+
+bool PexBase::compactStringTable()
+{
+    PexWorkspace workspace;
+    return compactStringTable(workspace);
+}
+
+bool PexBase::compactStringTable(PexWorkspace &workspace)
+{
+    workspace.reset();
+    PexScript script;
+    if (!PexParser::parse(m_data.data(), m_data.size(), m_endianOrder, m_header,
+                          workspace.arena, script, &workspace.stringReferences))
+        return false;
+
+    PexStringTable stringTable(script, m_data.data(), workspace.stringReferences, m_endianOrder);
+    if (!stringTable.isValid())
+        return false;
+
+    if (stringTable.isCompact())
+        return true;
+
+    if (!stringTable.write(m_data.data(), m_data.size(), workspace.buffer))
+        return false;
+
+    m_data.swap(workspace.buffer);
+    return true;
+}
+
+std::size_t PexBase::maskNames(const PexNameScanner &scanner, char mask, PexWorkspace &workspace)
+{
+    auto readLength = [this](std::size_t offset) -> std::size_t
+    {
+        if (m_endianOrder == ke::Order::big)
+            return (static_cast<std::size_t>(m_data[offset]) << 8) | m_data[offset + 1];
+        return (static_cast<std::size_t>(m_data[offset + 1]) << 8) | m_data[offset];
+    };
+
+    /// The string table is first, a count followed by length prefixed strings.
+    if (m_data.size() < sizeof(uint16_t))
+        return 0;
+
+    std::size_t count = readLength(0);
+    std::size_t offset = sizeof(uint16_t);
+    std::size_t masked = 0;
+    for (std::size_t i = 0; (i < count) && (offset + sizeof(uint16_t) <= m_data.size()); ++i)
+    {
+        std::size_t length = readLength(offset);
+        offset += sizeof(uint16_t);
+        if (offset + length > m_data.size())
+            break;
+
+        workspace.nameMatches.clear();
+        masked += scanner.scan(m_data.data() + offset, length, &workspace.nameMatches);
+        for (const auto &match: workspace.nameMatches)
+            std::fill_n(std::begin(m_data) + offset + match.offset, match.size, static_cast<uint8_t>(mask));
+
+        offset += length;
+    }
+
+    return masked;
+}
+
 PexBase::PexBase(const keeg::endian::Order &endianOrder) : m_endianOrder(endianOrder)
 { }
 
@@ -24,11 +24,17 @@
 
 #include <string>
 #include <vector>
+#include <afk/fileformats/pex/pexarena.hpp>
 #include <afk/fileformats/pex/pexheader.hpp>
+#include <afk/fileformats/pex/pexscript.hpp>
+#include <afk/fileformats/pex/pexview.hpp>
 #include <keeg/endian/conversion.hpp>
 
 namespace afk { namespace fileformats { namespace pex {
 
+struct PexWorkspace;
+class PexNameScanner;
+
 class PexBase
 {
 public:
@@ -46,6 +52,11 @@ public:
     void setUserName(const std::string &userName);
     void setMachineName(const std::string &machineName);
     void setData(const std::vector<uint8_t> &data);
+    /// Take over the buffers instead of copying them.
+    void setSourceFileName(std::string &&sourceFileName);
+    void setUserName(std::string &&userName);
+    void setMachineName(std::string &&machineName);
+    void setData(std::vector<uint8_t> &&data);
 
     /// Header version numbers identify the version of the pex file.
     virtual bool isPex(const PexHeader &pexHeader) = 0;
@@ -54,6 +65,37 @@ public:
     virtual std::size_t read(std::istream &instream);
     virtual std::size_t write(std::ostream &outstream);
 
+    /// Reads the header and the source, user and machine names, but not the data after them.
+    virtual std::size_t readHeaderStrings(std::istream &instream);
+    /// Writes the header and the source, user and machine names at the start of the stream.
+    /// Used to patch a file in place, so the string lengths must match the ones on disk.
+    virtual std::size_t writeHeaderStrings(std::ostream &outstream);
+    /// Same as the stream versions, reading from an already parsed view.
+    virtual std::size_t read(const PexView &view);
+    virtual std::size_t readHeaderStrings(const PexView &view);
+    /// Size in bytes of the header and the source, user and machine names.
+    std::size_t getHeaderStringsSize() const;
+
+    /// Parses the data into its string table, debug info, user flags and objects.
+    /// The script points into the data, so it's only valid until the data changes.
+    bool parseData(PexArena &arena, PexScript &script) const;
+
+    /// Replaces the debug info with the empty form, dropping the source modification
+    /// time and the line number tables. Returns false if the data can't be parsed.
+    bool stripDebugInfo();
+    bool stripDebugInfo(PexWorkspace &workspace);
+
+    /// Drops unreferenced strings, merges duplicates and remaps every reference to them.
+    /// Returns false if the data can't be parsed.
+    bool compactStringTable();
+    /// The old data ends up in the workspace buffer, so its memory is reused by the next file.
+    bool compactStringTable(PexWorkspace &workspace);
+
+    /// Masks the names wherever they appear inside a string of the string table.
+    /// Matches anywhere else are binary data that only look like a name, they're left alone.
+    /// Returns the number of names masked.
+    std::size_t maskNames(const PexNameScanner &scanner, char mask, PexWorkspace &workspace);
+
     inline virtual ~PexBase() { }
 
 protected:
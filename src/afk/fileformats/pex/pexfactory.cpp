@@ -24,71 +24,121 @@
 #include <afk/fileformats/pex/pexfallout4.hpp>
 #include <afk/fileformats/pex/pexskyrim.hpp>
 #include <afk/fileformats/pex/pexskyrimse.hpp>
+#include <algorithm>
+#include <mutex>
+#include <vector>
 
 namespace afk { namespace fileformats { namespace pex {
 
-std::unique_ptr<PexBase> PexFactory::createUniquePex(const std::string &game)
+namespace {
+
+struct PexRegistration
 {
-    std::unique_ptr<PexBase> pexBase;
-
-    if (game == "skyrim")
-        pexBase = std::make_unique<PexSkyrim>();
-    else if (game == "skyrimSE")
-        pexBase = std::make_unique<PexSkyrimSE>();
-    else if (game == "fallout4")
-        pexBase = std::make_unique<PexFallout4>();
-    else
-        pexBase = nullptr;
-
-    return std::move(pexBase);
+    const PexGameTraits *traits;
+    PexFactory::PexCreator creator;
+};
+
+template <typename T>
+std::unique_ptr<PexBase> createPex()
+{
+    return std::make_unique<T>();
 }
 
-std::unique_ptr<PexBase> PexFactory::createUniquePex(const GameID &gameID)
+/// Built-in games, checked in order without any locking.
+constexpr PexRegistration builtInPex[] = {
+    { &skyrimTraits,    &createPex<PexSkyrim> },
+    { &skyrimSETraits,  &createPex<PexSkyrimSE> },
+    { &fallout4Traits,  &createPex<PexFallout4> },
+};
+
+/// Games added at runtime through PexFactory::registerPex.
+std::mutex registeredPexMutex;
+std::vector<PexRegistration> registeredPex;
+
+/// Returns a copy, registerPex may grow the vector as soon as the lock is released.
+/// Empty when nothing matches.
+template <typename Predicate>
+PexRegistration findRegistration(Predicate predicate)
 {
-    std::unique_ptr<PexBase> pexBase = nullptr;
+    auto it = std::find_if(std::begin(builtInPex), std::end(builtInPex), predicate);
+    if (it != std::end(builtInPex))
+        return *it;
 
-    if (gameID == GameID::skyrim)
-        pexBase = std::make_unique<PexSkyrim>();
-    else if (gameID == GameID::skyrimSE)
-        pexBase = std::make_unique<PexSkyrimSE>();
-    else if (gameID == GameID::fallout4)
-        pexBase = std::make_unique<PexFallout4>();
+    std::lock_guard<std::mutex> lock(registeredPexMutex);
+    auto found = std::find_if(std::begin(registeredPex), std::end(registeredPex), predicate);
+    return (found != std::end(registeredPex)) ? *found : PexRegistration{nullptr, nullptr};
+}
 
-    return std::move(pexBase);
+std::unique_ptr<PexBase> create(const PexRegistration &registration)
+{
+    return registration.creator ? registration.creator() : nullptr;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<PexBase> PexFactory::createUniquePex(const std::string &game)
+{
+    return create(findRegistration([&game](const PexRegistration &registration) {
+        return game == registration.traits->name;
+    }));
+}
+
+std::unique_ptr<PexBase> PexFactory::createUniquePex(const GameID &gameID)
+{
+    return create(findRegistration([&gameID](const PexRegistration &registration) {
+        return registration.traits->gameId == static_cast<uint16_t>(gameID);
+    }));
 }
 
 std::unique_ptr<PexBase> PexFactory::createUniquePex(const PexHeader &pexHeader)
 {
-    std::unique_ptr<PexBase> pexBase;
-
-    if (PexSkyrim().isPex(pexHeader))
-        pexBase = std::make_unique<PexSkyrim>();
-    else if (PexSkyrimSE().isPex(pexHeader))
-        pexBase = std::make_unique<PexSkyrimSE>();
-    else if (PexFallout4().isPex(pexHeader))
-        pexBase = std::make_unique<PexFallout4>();
-    else
-        pexBase = nullptr;
-
-    return pexBase;
+    return create(findRegistration([&pexHeader](const PexRegistration &registration) {
+        return registration.traits->matches(pexHeader);
+    }));
 }
 
 std::unique_ptr<PexBase> PexFactory::createUniquePex(std::istream &instream)
 {
-    std::unique_ptr<PexBase> pexBase = nullptr;
-
     PexHeader pexHeader;
     if (pexHeader.read(instream))
-    {
-        if (PexSkyrim().isPex(pexHeader))
-            pexBase = std::make_unique<PexSkyrim>();
-        else if (PexSkyrimSE().isPex(pexHeader))
-            pexBase = std::make_unique<PexSkyrimSE>();
-        else if (PexFallout4().isPex(pexHeader))
-            pexBase = std::make_unique<PexFallout4>();
-    }
-
-    return std::move(pexBase);
+        return createUniquePex(pexHeader);
+
+    return nullptr;
+}
+
+std::unique_ptr<PexBase> PexFactory::createUniquePex(const PexView &view)
+{
+    if (!view.isValid())
+        return nullptr;
+
+    return createUniquePex(view.getPexHeader());
+}
+
+const PexGameTraits* PexFactory::findGameTraits(const PexHeader &pexHeader)
+{
+    return findRegistration([&pexHeader](const PexRegistration &r) {
+        return r.traits->matches(pexHeader);
+    }).traits;
+}
+
+bool PexFactory::registerPex(const PexGameTraits &traits, PexCreator creator)
+{
+    if (!creator)
+        return false;
+
+    auto isSameGame = [&traits](const PexRegistration &registration) {
+        return registration.traits->matches(traits);
+    };
+
+    if (std::any_of(std::begin(builtInPex), std::end(builtInPex), isSameGame))
+        return false;
+
+    std::lock_guard<std::mutex> lock(registeredPexMutex);
+    if (std::any_of(std::begin(registeredPex), std::end(registeredPex), isSameGame))
+        return false;
+
+    registeredPex.push_back(PexRegistration{&traits, creator});
+    return true;
 }
 
 } // pex namespace
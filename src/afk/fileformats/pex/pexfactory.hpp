@@ -24,6 +24,7 @@
 
 #include <afk/fileformats/pex/gameid.hpp>
 #include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexgametraits.hpp>
 #include <memory>
 #include <istream>
 
@@ -32,10 +33,20 @@ namespace afk { namespace fileformats { namespace pex {
 class PexFactory
 {
 public:
+    using PexCreator = std::unique_ptr<PexBase> (*)();
+
     static std::unique_ptr<PexBase> createUniquePex(const std::string &game);
     static std::unique_ptr<PexBase> createUniquePex(const GameID &gameID);
     static std::unique_ptr<PexBase> createUniquePex(const PexHeader &pexHeader);
     static std::unique_ptr<PexBase> createUniquePex(std::istream &instream);
+    static std::unique_ptr<PexBase> createUniquePex(const PexView &view);
+
+    /// Looks up the game a header belongs to, nullptr if it's unknown.
+    static const PexGameTraits* findGameTraits(const PexHeader &pexHeader);
+
+    /// Adds support for another game or version. The traits must outlive the factory.
+    /// Returns false if a game with the same header values is already known.
+    static bool registerPex(const PexGameTraits &traits, PexCreator creator);
 
 protected:
     PexFactory() { }
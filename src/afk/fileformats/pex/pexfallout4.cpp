@@ -20,43 +20,24 @@
  * IN THE SOFTWARE.
  */
 #include <afk/fileformats/pex/pexfallout4.hpp>
-#include <afk/fileformats/pex/gameid.hpp>
-#include <keeg/common/enums.hpp>
+#include <afk/fileformats/pex/pexgametraits.hpp>
 #include <ctime>
 
 namespace afk { namespace fileformats { namespace pex {
 
-namespace kc = keeg::common;
-
 /// Fallout 4 pex files use Little-Endian ordering for numbers.
-PexFallout4::PexFallout4() : PexBase(keeg::endian::Order::little)
+PexFallout4::PexFallout4() : PexBase(fallout4Traits.endianOrder)
 {
-    m_header.magic = UINT32_C(0xFA57C0DE);
-    m_header.majorVersion = 3;
-    m_header.minorVersion = 9;
-    m_header.gameId = kc::enumToIntegral(GameID::fallout4);
+    m_header.magic = fallout4Traits.magic;
+    m_header.majorVersion = fallout4Traits.majorVersion;
+    m_header.minorVersion = fallout4Traits.minorVersion;
+    m_header.gameId = fallout4Traits.gameId;
     m_header.compilationTime = static_cast<uint64_t>(time(NULL));
 }
 
 bool PexFallout4::isPex(const PexHeader &pexHeader)
 {
-    try
-    {
-        if ((pexHeader.magic == UINT32_C(0xFA57C0DE)) &&
-                (pexHeader.majorVersion == 3) &&
-                (pexHeader.minorVersion == 9) &&
-                (pexHeader.gameId == kc::enumToIntegral(GameID::fallout4)))
-        {
-            return true;
-        }
-    }
-    catch (const std::exception &ex)
-    {
-        std::cerr << ex.what() << std::endl;
-        return false;
-    }
-
-    return false;
+    return fallout4Traits.matches(pexHeader);
 }
 
 } // pex namespace
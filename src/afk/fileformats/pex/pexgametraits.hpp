@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXGAMETRAITS_HPP
+#define PEXGAMETRAITS_HPP
+
+#include <cstdint>
+#include <afk/fileformats/pex/gameid.hpp>
+#include <afk/fileformats/pex/pexheader.hpp>
+#include <keeg/endian/conversion.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Header values that identify the pex files of a game.
+struct PexGameTraits
+{
+    const char *name;
+    uint32_t magic;
+    uint8_t  majorVersion;
+    uint8_t  minorVersion;
+    uint16_t gameId;
+    keeg::endian::Order endianOrder;
+
+    constexpr bool matches(const PexHeader &pexHeader) const
+    {
+        return (pexHeader.magic == magic) &&
+                (pexHeader.majorVersion == majorVersion) &&
+                (pexHeader.minorVersion == minorVersion) &&
+                (pexHeader.gameId == gameId);
+    }
+
+    constexpr bool matches(const PexGameTraits &traits) const
+    {
+        return (traits.magic == magic) &&
+                (traits.majorVersion == majorVersion) &&
+                (traits.minorVersion == minorVersion) &&
+                (traits.gameId == gameId);
+    }
+};
+
+/// Skyrim pex files use Big-Endian ordering for numbers.
+constexpr PexGameTraits skyrimTraits{
+    "skyrim", UINT32_C(0xFA57C0DE), 3, 2,
+    static_cast<uint16_t>(GameID::skyrim), keeg::endian::Order::big
+};
+
+/// SkyrimSE pex files use Big-Endian ordering for numbers.
+constexpr PexGameTraits skyrimSETraits{
+    "skyrimSE", UINT32_C(0xFA57C0DE), 3, 1,
+    static_cast<uint16_t>(GameID::skyrimSE), keeg::endian::Order::big
+};
+
+/// Fallout 4 pex files use Little-Endian ordering for numbers.
+constexpr PexGameTraits fallout4Traits{
+    "fallout4", UINT32_C(0xFA57C0DE), 3, 9,
+    static_cast<uint16_t>(GameID::fallout4), keeg::endian::Order::little
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXGAMETRAITS_HPP
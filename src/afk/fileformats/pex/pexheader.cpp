@@ -23,6 +23,7 @@
 #include <keeg/io/binaryreaders.hpp>
 #include <keeg/endian/conversion.hpp>
 #include <keeg/common/stringutils.hpp>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
 
@@ -36,25 +37,7 @@ std::size_t PexHeader::read(std::istream &instream)
         {
             instream.seekg(0, std::ios::beg);
             if (keeg::io::readPODType<PexHeader>(instream, *this))
-            {
-                std::size_t status = 0;
-                switch (magic) {
-                case UINT32_C(0xFA57C0DE):
-                    status = 1;
-                    break;
-                /// File data is in reverse endian of the host machine.
-                case UINT32_C(0xDEC057FA):
-                    magic = keeg::endian::swap(magic);
-                    gameId = keeg::endian::swap(gameId);
-                    compilationTime = keeg::endian::swap(compilationTime);
-                    status = 1;
-                    break;
-                default:
-                    break;
-                }
-
-                return status;
-            }
+                return toHostOrder();
         }
     }
     catch (const std::exception &ex)
@@ -66,6 +49,36 @@ std::size_t PexHeader::read(std::istream &instream)
     return 0;
 }
 
+std::size_t PexHeader::read(const uint8_t *data, std::size_t size)
+{
+    if (!data || (size < sizeof(PexHeader)))
+        return 0;
+
+    std::memcpy(this, data, sizeof(PexHeader));
+    return toHostOrder();
+}
+
+std::size_t PexHeader::toHostOrder()
+{
+    std::size_t status = 0;
+    switch (magic) {
+    case UINT32_C(0xFA57C0DE):
+        status = 1;
+        break;
+    /// File data is in reverse endian of the host machine.
+    case UINT32_C(0xDEC057FA):
+        magic = keeg::endian::swap(magic);
+        gameId = keeg::endian::swap(gameId);
+        compilationTime = keeg::endian::swap(compilationTime);
+        status = 1;
+        break;
+    default:
+        break;
+    }
+
+    return status;
+}
+
 std::ostream & operator <<(std::ostream &o, const PexHeader &pexHeader)
 {
     char buildTimeStr[27];
@@ -36,6 +36,11 @@ struct PexHeader
     uint64_t compilationTime;   // 08	time_t usually uint64_t
 
     std::size_t read(std::istream &instream);
+    std::size_t read(const uint8_t *data, std::size_t size);
+
+private:
+    /// Swaps the fields read from a file in the reverse endian of the host machine.
+    std::size_t toHostOrder();
 };
 
 std::ostream & operator <<(std::ostream &o, const PexHeader &pexHeader);
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/pex/pexnamescanner.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PEX_SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+/// GCC and Clang can build the AVX2 version without -mavx2 and pick it at runtime.
+#if defined(PEX_SCANNER_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PEX_SCANNER_AVX2
+#define PEX_SCANNER_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define PEX_SCANNER_AVX2
+#define PEX_SCANNER_AVX2_TARGET
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace afk { namespace fileformats { namespace pex {
+
+namespace {
+
+/// Returns the start of the first occurrence of the name in [begin, end), or end.
+using FindFunction = const uint8_t* (*)(const uint8_t *begin, const uint8_t *end, const std::string &name);
+
+inline unsigned lowestBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline bool matchesRest(const uint8_t *candidate, const std::string &name)
+{
+    /// The first and last bytes were already compared.
+    return std::memcmp(candidate + 1, name.data() + 1, name.size() - 2) == 0;
+}
+
+const uint8_t* findScalar(const uint8_t *begin, const uint8_t *end, const std::string &name)
+{
+    const std::size_t size = name.size();
+    const uint8_t first = static_cast<uint8_t>(name.front());
+    const uint8_t last = static_cast<uint8_t>(name.back());
+    if (static_cast<std::size_t>(end - begin) < size)
+        return end;
+
+    const uint8_t *lastStart = end - size;
+    for (const uint8_t *current = begin; current <= lastStart; ++current)
+    {
+        current = static_cast<const uint8_t*>(std::memchr(current, first, lastStart - current + 1));
+        if (!current)
+            return end;
+        if ((current[size - 1] == last) && matchesRest(current, name))
+            return current;
+    }
+
+    return end;
+}
+
+#if defined(PEX_SCANNER_SSE2)
+/// Compares the first and last byte of the name at 16 starting positions at once,
+/// only the rare positions where both match are checked in full.
+const uint8_t* findSse2(const uint8_t *begin, const uint8_t *end, const std::string &name)
+{
+    const std::size_t size = name.size();
+    if (static_cast<std::size_t>(end - begin) < size)
+        return end;
+
+    const __m128i first = _mm_set1_epi8(name.front());
+    const __m128i last = _mm_set1_epi8(name.back());
+    const uint8_t *lastStart = end - size;
+
+    const uint8_t *current = begin;
+    for (; current + 15 <= lastStart; current += 16)
+    {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + size - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+        while (mask)
+        {
+            const uint8_t *candidate = current + lowestBit(mask);
+            if (matchesRest(candidate, name))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return findScalar(current, end, name);
+}
+#endif
+
+#if defined(PEX_SCANNER_AVX2)
+PEX_SCANNER_AVX2_TARGET
+const uint8_t* findAvx2(const uint8_t *begin, const uint8_t *end, const std::string &name)
+{
+    const std::size_t size = name.size();
+    if (static_cast<std::size_t>(end - begin) < size)
+        return end;
+
+    const __m256i first = _mm256_set1_epi8(name.front());
+    const __m256i last = _mm256_set1_epi8(name.back());
+    const uint8_t *lastStart = end - size;
+
+    const uint8_t *current = begin;
+    for (; current + 31 <= lastStart; current += 32)
+    {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current));
+        const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current + size - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+        while (mask)
+        {
+            const uint8_t *candidate = current + lowestBit(mask);
+            if (matchesRest(candidate, name))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return findSse2(current, end, name);
+}
+#endif
+
+struct Finder
+{
+    FindFunction find;
+    const char *name;
+};
+
+Finder selectFinder()
+{
+#if defined(PEX_SCANNER_AVX2) && defined(__AVX2__)
+    return Finder{&findAvx2, "AVX2"};
+#elif defined(PEX_SCANNER_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+        return Finder{&findAvx2, "AVX2"};
+    return Finder{&findSse2, "SSE2"};
+#elif defined(PEX_SCANNER_SSE2)
+    return Finder{&findSse2, "SSE2"};
+#else
+    return Finder{&findScalar, "Scalar"};
+#endif
+}
+
+const Finder& getFinder()
+{
+    static const Finder finder = selectFinder();
+    return finder;
+}
+
+} // anonymous namespace
+
+void PexNameScanner::addName(boost::string_view name)
+{
+    if (name.size() < minNameSize)
+        return;
+
+    if (std::find(std::begin(m_names), std::end(m_names), name) == std::end(m_names))
+        m_names.push_back(name.to_string());
+}
+
+std::size_t PexNameScanner::scan(const uint8_t *data, std::size_t size, std::vector<PexNameMatch> *matches) const
+{
+    if (!data)
+        return 0;
+
+    const FindFunction find = getFinder().find;
+    const uint8_t *end = data + size;
+    std::size_t count = 0;
+
+    for (const auto &name: m_names)
+    {
+        for (const uint8_t *found = find(data, end, name); found != end; found = find(found + name.size(), end, name))
+        {
+            ++count;
+            if (matches)
+                matches->push_back(PexNameMatch{static_cast<std::size_t>(found - data), name.size()});
+        }
+    }
+
+    return count;
+}
+
+const char* PexNameScanner::getInstructionSet()
+{
+    return getFinder().name;
+}
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
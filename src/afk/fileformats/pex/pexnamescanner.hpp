@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXNAMESCANNER_HPP
+#define PEXNAMESCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+struct PexNameMatch
+{
+    std::size_t offset;
+    std::size_t size;
+};
+
+/// Finds user and machine names anywhere in the data of a pex file.
+/// Uses AVX2 when the processor has it, then SSE2, then plain C++.
+class PexNameScanner
+{
+public:
+    /// Shorter names would match all over the data.
+    static const std::size_t minNameSize = 3;
+
+    PexNameScanner() { }
+
+    /// Names that are too short or already added are ignored.
+    void addName(boost::string_view name);
+    inline bool empty() const { return m_names.empty(); }
+
+    /// Counts every occurrence of every name, matches of the same name don't overlap.
+    /// The matches are added in order of offset for each name, if matches isn't null.
+    std::size_t scan(const uint8_t *data, std::size_t size, std::vector<PexNameMatch> *matches = nullptr) const;
+
+    /// Name of the instruction set in use, for verbose output.
+    static const char* getInstructionSet();
+
+private:
+    std::vector<std::string> m_names;
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXNAMESCANNER_HPP
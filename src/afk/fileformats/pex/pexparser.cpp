@@ -0,0 +1,548 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/pex/pexparser.hpp>
+#include <afk/fileformats/pex/gameid.hpp>
+#include <cstring>
+
+namespace afk { namespace fileformats { namespace pex {
+
+namespace ke = keeg::endian;
+
+namespace {
+
+const PexOpcodeInfo opcodes[] = {
+    { "nop",                    0, false },     // 0x00
+    { "iadd",                   3, false },
+    { "fadd",                   3, false },
+    { "isub",                   3, false },
+    { "fsub",                   3, false },
+    { "imul",                   3, false },
+    { "fmul",                   3, false },
+    { "idiv",                   3, false },
+    { "fdiv",                   3, false },     // 0x08
+    { "imod",                   3, false },
+    { "not",                    2, false },
+    { "ineg",                   2, false },
+    { "fneg",                   2, false },
+    { "assign",                 2, false },
+    { "cast",                   2, false },
+    { "cmp_eq",                 3, false },
+    { "cmp_lt",                 3, false },     // 0x10
+    { "cmp_le",                 3, false },
+    { "cmp_gt",                 3, false },
+    { "cmp_ge",                 3, false },
+    { "jmp",                    1, false },
+    { "jmpt",                   2, false },
+    { "jmpf",                   2, false },
+    { "callmethod",             3, true  },
+    { "callparent",             2, true  },     // 0x18
+    { "callstatic",             3, true  },
+    { "return",                 1, false },
+    { "strcat",                 3, false },
+    { "propget",                3, false },
+    { "propset",                3, false },
+    { "array_create",           2, false },
+    { "array_length",           2, false },
+    { "array_getelement",       3, false },     // 0x20
+    { "array_setelement",       3, false },
+    { "array_findelement",      4, false },
+    { "array_rfindelement",     4, false },
+    /// Fallout 4
+    { "is",                     3, false },     // 0x24
+    { "struct_create",          1, false },
+    { "struct_get",             3, false },
+    { "struct_set",             3, false },
+    { "array_findstruct",       5, false },     // 0x28
+    { "array_rfindstruct",      5, false },
+    { "array_add",              3, false },
+    { "array_insert",           3, false },
+    { "array_removelast",       1, false },
+    { "array_remove",           3, false },
+    { "array_clear",            1, false },     // 0x2E
+};
+
+const uint8_t skyrimOpcodeCount = 0x24;
+const uint8_t fallout4OpcodeCount = 0x2F;
+
+/// Bounds checked reader, stops reading and stays failed after the first overrun.
+class PexReader
+{
+public:
+    PexReader(const uint8_t *data, std::size_t size, ke::Order endianOrder)
+        : m_begin(data), m_current(data), m_end(data + size), m_bigEndian(endianOrder == ke::Order::big)
+    { }
+
+    inline bool ok() const { return m_ok; }
+    inline std::size_t offset() const { return static_cast<std::size_t>(m_current - m_begin); }
+    inline std::size_t remaining() const { return static_cast<std::size_t>(m_end - m_current); }
+
+    uint8_t u8()
+    {
+        if (!require(1))
+            return 0;
+        return *m_current++;
+    }
+
+    uint16_t u16()
+    {
+        return static_cast<uint16_t>(unsignedValue(2));
+    }
+
+    uint32_t u32()
+    {
+        return static_cast<uint32_t>(unsignedValue(4));
+    }
+
+    uint64_t u64()
+    {
+        return unsignedValue(8);
+    }
+
+    float f32()
+    {
+        uint32_t bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    boost::string_view wstring()
+    {
+        std::size_t length = u16();
+        if (!require(length))
+            return boost::string_view();
+
+        boost::string_view value(reinterpret_cast<const char*>(m_current), length);
+        m_current += length;
+        return value;
+    }
+
+    /// Every element takes at least a byte, so larger counts can't be valid.
+    bool fits(std::size_t count)
+    {
+        return require(count) || (count == 0);
+    }
+
+    void fail()
+    {
+        m_ok = false;
+        m_current = m_end;
+    }
+
+private:
+    const uint8_t *m_begin;
+    const uint8_t *m_current;
+    const uint8_t *m_end;
+    bool m_bigEndian;
+    bool m_ok = true;
+
+    bool require(std::size_t size)
+    {
+        if (m_ok && (size <= remaining()))
+            return true;
+
+        fail();
+        return false;
+    }
+
+    uint64_t unsignedValue(std::size_t size)
+    {
+        if (!require(size))
+            return 0;
+
+        uint64_t value = 0;
+        if (m_bigEndian)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+                value = (value << 8) | m_current[i];
+        }
+        else
+        {
+            for (std::size_t i = size; i > 0; --i)
+                value = (value << 8) | m_current[i - 1];
+        }
+
+        m_current += size;
+        return value;
+    }
+};
+
+class ScriptParser
+{
+public:
+    ScriptParser(PexReader &reader, PexArena &arena, bool fallout4, std::vector<uint32_t> *stringReferences)
+        : m_reader(reader), m_arena(arena), m_fallout4(fallout4), m_stringReferences(stringReferences)
+    { }
+
+    bool parse(PexScript &script)
+    {
+        script = PexScript();
+
+        script.stringTableSection.offset = m_reader.offset();
+        if (!allocate(script.strings, m_reader.u16()))
+            return false;
+        for (auto &string: script.strings)
+            string = m_reader.wstring();
+        script.stringTableSection.size = m_reader.offset() - script.stringTableSection.offset;
+
+        script.debugInfoSection.offset = m_reader.offset();
+        if (!parseDebugInfo(script.debugInfo))
+            return false;
+        script.debugInfoSection.size = m_reader.offset() - script.debugInfoSection.offset;
+
+        script.userFlagsSection.offset = m_reader.offset();
+        if (!allocate(script.userFlags, m_reader.u16()))
+            return false;
+        for (auto &userFlag: script.userFlags)
+        {
+            userFlag.name = stringIndex();
+            userFlag.flagIndex = m_reader.u8();
+        }
+        script.userFlagsSection.size = m_reader.offset() - script.userFlagsSection.offset;
+
+        script.objectsSection.offset = m_reader.offset();
+        if (!allocate(script.objects, m_reader.u16()))
+            return false;
+        for (auto &object: script.objects)
+            if (!parseObject(object))
+                return false;
+        script.objectsSection.size = m_reader.offset() - script.objectsSection.offset;
+
+        return m_reader.ok();
+    }
+
+private:
+    PexReader &m_reader;
+    PexArena &m_arena;
+    bool m_fallout4;
+    std::vector<uint32_t> *m_stringReferences;
+
+    template <typename T>
+    bool allocate(PexArray<T> &array, std::size_t count)
+    {
+        array.count = 0;
+        array.items = nullptr;
+        if (!m_reader.ok() || !m_reader.fits(count))
+            return false;
+
+        array.items = m_arena.allocate<T>(count);
+        array.count = count;
+        return true;
+    }
+
+    bool parseIndexes(PexArray<uint16_t> &indexes, bool isStringIndex)
+    {
+        if (!allocate(indexes, m_reader.u16()))
+            return false;
+        for (auto &index: indexes)
+            index = isStringIndex ? stringIndex() : m_reader.u16();
+        return m_reader.ok();
+    }
+
+    /// Reads a string table index, remembering where it was for remapping.
+    uint16_t stringIndex()
+    {
+        if (m_stringReferences && m_reader.ok())
+            m_stringReferences->push_back(static_cast<uint32_t>(m_reader.offset()));
+        return m_reader.u16();
+    }
+
+    bool parseDebugInfo(PexDebugInfo &debugInfo)
+    {
+        debugInfo.hasDebugInfo = (m_reader.u8() != 0);
+        if (!debugInfo.hasDebugInfo)
+            return m_reader.ok();
+
+        debugInfo.modificationTime = m_reader.u64();
+        if (!allocate(debugInfo.functions, m_reader.u16()))
+            return false;
+        for (auto &function: debugInfo.functions)
+        {
+            function.objectName = stringIndex();
+            function.stateName = stringIndex();
+            function.functionName = stringIndex();
+            function.functionType = m_reader.u8();
+            if (!parseIndexes(function.lineNumbers, false))
+                return false;
+        }
+
+        if (m_fallout4)
+        {
+            if (!allocate(debugInfo.propertyGroups, m_reader.u16()))
+                return false;
+            for (auto &group: debugInfo.propertyGroups)
+            {
+                group.objectName = stringIndex();
+                group.groupName = stringIndex();
+                group.docString = stringIndex();
+                group.userFlags = m_reader.u32();
+                if (!parseIndexes(group.propertyNames, true))
+                    return false;
+            }
+
+            if (!allocate(debugInfo.structOrders, m_reader.u16()))
+                return false;
+            for (auto &order: debugInfo.structOrders)
+            {
+                order.objectName = stringIndex();
+                order.orderName = stringIndex();
+                if (!parseIndexes(order.names, true))
+                    return false;
+            }
+        }
+
+        return m_reader.ok();
+    }
+
+    bool parseValue(PexValue &value)
+    {
+        value.type = static_cast<PexValueType>(m_reader.u8());
+        value.integer = 0;
+        switch (value.type) {
+        case PexValueType::none:
+            break;
+        case PexValueType::identifier:
+        case PexValueType::string:
+            value.stringIndex = stringIndex();
+            break;
+        case PexValueType::integer:
+            value.integer = static_cast<int32_t>(m_reader.u32());
+            break;
+        case PexValueType::real:
+            value.real = m_reader.f32();
+            break;
+        case PexValueType::boolean:
+            value.boolean = m_reader.u8();
+            break;
+        default:
+            m_reader.fail();
+            break;
+        }
+
+        return m_reader.ok();
+    }
+
+    bool parseVariableTypes(PexArray<PexVariableType> &types)
+    {
+        if (!allocate(types, m_reader.u16()))
+            return false;
+        for (auto &type: types)
+        {
+            type.name = stringIndex();
+            type.type = stringIndex();
+        }
+        return m_reader.ok();
+    }
+
+    bool parseInstruction(PexInstruction &instruction)
+    {
+        instruction.opcode = m_reader.u8();
+        const PexOpcodeInfo *info = PexParser::getOpcodeInfo(instruction.opcode, m_fallout4);
+        if (!info)
+        {
+            m_reader.fail();
+            return false;
+        }
+
+        PexValue fixed[8];
+        std::size_t count = info->argumentCount;
+        for (std::size_t i = 0; i < count; ++i)
+            if (!parseValue(fixed[i]))
+                return false;
+
+        PexValue varArgCount;
+        std::size_t varArgs = 0;
+        if (info->hasVarArgs)
+        {
+            if (!parseValue(varArgCount) || (varArgCount.type != PexValueType::integer)
+                    || (varArgCount.integer < 0))
+            {
+                m_reader.fail();
+                return false;
+            }
+            varArgs = static_cast<std::size_t>(varArgCount.integer);
+            ++count;
+        }
+
+        /// The fixed arguments were already read, only the variable ones are still ahead.
+        if (!m_reader.fits(varArgs))
+            return false;
+
+        instruction.arguments.items = m_arena.allocate<PexValue>(count + varArgs);
+        instruction.arguments.count = count + varArgs;
+
+        std::memcpy(instruction.arguments.items, fixed, sizeof(PexValue) * info->argumentCount);
+        if (info->hasVarArgs)
+        {
+            instruction.arguments[info->argumentCount] = varArgCount;
+            for (std::size_t i = count; i < count + varArgs; ++i)
+                if (!parseValue(instruction.arguments[i]))
+                    return false;
+        }
+
+        return m_reader.ok();
+    }
+
+    bool parseFunction(PexFunction &function)
+    {
+        function.returnType = stringIndex();
+        function.docString = stringIndex();
+        function.userFlags = m_reader.u32();
+        function.flags = m_reader.u8();
+        if (!parseVariableTypes(function.params) || !parseVariableTypes(function.locals))
+            return false;
+
+        if (!allocate(function.instructions, m_reader.u16()))
+            return false;
+        for (auto &instruction: function.instructions)
+            if (!parseInstruction(instruction))
+                return false;
+
+        return m_reader.ok();
+    }
+
+    bool parseObject(PexObject &object)
+    {
+        object = PexObject();
+        object.name = stringIndex();
+        /// Size of the object data plus the size field itself, not needed for parsing.
+        m_reader.u32();
+        object.section.offset = m_reader.offset();
+
+        object.parentClassName = stringIndex();
+        object.docString = stringIndex();
+        if (m_fallout4)
+            object.constFlag = m_reader.u8();
+        object.userFlags = m_reader.u32();
+        object.autoStateName = stringIndex();
+
+        if (m_fallout4)
+        {
+            if (!allocate(object.structs, m_reader.u16()))
+                return false;
+            for (auto &structInfo: object.structs)
+            {
+                structInfo.name = stringIndex();
+                if (!allocate(structInfo.members, m_reader.u16()))
+                    return false;
+                for (auto &member: structInfo.members)
+                {
+                    member.name = stringIndex();
+                    member.typeName = stringIndex();
+                    member.userFlags = m_reader.u32();
+                    if (!parseValue(member.value))
+                        return false;
+                    member.constFlag = m_reader.u8();
+                    member.docString = stringIndex();
+                }
+            }
+        }
+
+        if (!allocate(object.variables, m_reader.u16()))
+            return false;
+        for (auto &variable: object.variables)
+        {
+            variable.name = stringIndex();
+            variable.typeName = stringIndex();
+            variable.userFlags = m_reader.u32();
+            if (!parseValue(variable.value))
+                return false;
+            variable.constFlag = m_fallout4 ? m_reader.u8() : 0;
+        }
+
+        if (!allocate(object.properties, m_reader.u16()))
+            return false;
+        for (auto &property: object.properties)
+        {
+            property = PexProperty();
+            property.name = stringIndex();
+            property.type = stringIndex();
+            property.docString = stringIndex();
+            property.userFlags = m_reader.u32();
+            property.flags = m_reader.u8();
+            if (property.flags & 0x04)
+            {
+                property.autoVarName = stringIndex();
+            }
+            else
+            {
+                if ((property.flags & 0x01) && !parseFunction(property.readHandler))
+                    return false;
+                if ((property.flags & 0x02) && !parseFunction(property.writeHandler))
+                    return false;
+            }
+        }
+
+        if (!allocate(object.states, m_reader.u16()))
+            return false;
+        for (auto &state: object.states)
+        {
+            state.name = stringIndex();
+            if (!allocate(state.functions, m_reader.u16()))
+                return false;
+            for (auto &function: state.functions)
+            {
+                function.name = stringIndex();
+                if (!parseFunction(function.function))
+                    return false;
+            }
+        }
+
+        object.section.size = m_reader.offset() - object.section.offset;
+
+        return m_reader.ok();
+    }
+};
+
+} // anonymous namespace
+
+bool PexParser::parse(const uint8_t *data, std::size_t size, keeg::endian::Order endianOrder,
+                      const PexHeader &pexHeader, PexArena &arena, PexScript &script,
+                      std::vector<uint32_t> *stringReferences)
+{
+    if (!data)
+        return false;
+
+    if (stringReferences)
+        stringReferences->clear();
+
+    PexReader reader(data, size, endianOrder);
+    ScriptParser parser(reader, arena, hasFallout4Layout(pexHeader), stringReferences);
+    return parser.parse(script) && (reader.remaining() == 0);
+}
+
+bool PexParser::hasFallout4Layout(const PexHeader &pexHeader)
+{
+    return pexHeader.gameId == static_cast<uint16_t>(GameID::fallout4);
+}
+
+const PexOpcodeInfo* PexParser::getOpcodeInfo(uint8_t opcode, bool fallout4)
+{
+    if (opcode >= (fallout4 ? fallout4OpcodeCount : skyrimOpcodeCount))
+        return nullptr;
+
+    return &opcodes[opcode];
+}
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXPARSER_HPP
+#define PEXPARSER_HPP
+
+#include <cstdint>
+#include <vector>
+#include <afk/fileformats/pex/pexarena.hpp>
+#include <afk/fileformats/pex/pexheader.hpp>
+#include <afk/fileformats/pex/pexscript.hpp>
+#include <keeg/endian/conversion.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+struct PexOpcodeInfo
+{
+    const char *name;
+    uint8_t argumentCount;
+    /// Fixed arguments are followed by an integer count and that many more arguments.
+    bool hasVarArgs;
+};
+
+/// Structural parser for everything after the machine name:
+/// string table, debug info, user flags and objects.
+class PexParser
+{
+public:
+    /// The nodes are allocated from the arena and the strings point into data,
+    /// both have to outlive the script. Returns false on truncated or unknown data.
+    /// stringReferences receives the offset of every string table index in the data.
+    static bool parse(const uint8_t *data, std::size_t size, keeg::endian::Order endianOrder,
+                      const PexHeader &pexHeader, PexArena &arena, PexScript &script,
+                      std::vector<uint32_t> *stringReferences = nullptr);
+
+    /// Fallout 4 added structs, const flags, property groups and struct orders.
+    static bool hasFallout4Layout(const PexHeader &pexHeader);
+
+    /// nullptr for opcodes the game doesn't have.
+    static const PexOpcodeInfo* getOpcodeInfo(uint8_t opcode, bool fallout4);
+
+protected:
+    PexParser() { }
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXPARSER_HPP
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/pex/pexpool.hpp>
+#include <afk/fileformats/pex/pexfactory.hpp>
+#include <algorithm>
+#include <iterator>
+
+namespace afk { namespace fileformats { namespace pex {
+
+void PexPool::Recycler::operator ()(PexBase *pex) const
+{
+    if (m_pool)
+        m_pool->release(m_traits, pex);
+    else
+        delete pex;
+}
+
+PexPool::Pointer PexPool::acquire(const PexHeader &pexHeader)
+{
+    const PexGameTraits *traits = PexFactory::findGameTraits(pexHeader);
+    if (!traits)
+        return Pointer(nullptr, Recycler(this, nullptr));
+
+    auto it = std::find_if(std::begin(m_free), std::end(m_free),
+                           [traits](const FreeEntry &entry) { return entry.traits == traits; });
+    if (it != std::end(m_free))
+    {
+        PexBase *pex = it->pex.release();
+        m_free.erase(it);
+        return Pointer(pex, Recycler(this, traits));
+    }
+
+    ++m_created;
+    return Pointer(PexFactory::createUniquePex(pexHeader).release(), Recycler(this, traits));
+}
+
+PexPool::Pointer PexPool::acquire(const PexView &view)
+{
+    if (!view.isValid())
+        return Pointer(nullptr, Recycler(this, nullptr));
+
+    return acquire(view.getPexHeader());
+}
+
+void PexPool::release(const PexGameTraits *traits, PexBase *pex)
+{
+    std::unique_ptr<PexBase> owned(pex);
+    if (!owned || !traits || (m_free.size() >= maxFreeCount))
+        return;
+
+    if (owned->getData().capacity() > maxRetainedCapacity)
+        owned->setData(std::vector<uint8_t>());
+
+    m_free.push_back(FreeEntry{traits, std::move(owned)});
+}
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXPOOL_HPP
+#define PEXPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <afk/fileformats/pex/pexarena.hpp>
+#include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexgametraits.hpp>
+#include <afk/fileformats/pex/pexheader.hpp>
+#include <afk/fileformats/pex/pexnamescanner.hpp>
+#include <afk/fileformats/pex/pexview.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Scratch memory for parsing and rewriting the data, reused from one file to the next.
+struct PexWorkspace
+{
+    PexArena arena;
+    std::vector<uint32_t> stringReferences;
+    std::vector<uint8_t> buffer;
+    std::vector<PexNameMatch> nameMatches;
+
+    void reset()
+    {
+        arena.reset();
+        stringReferences.clear();
+        nameMatches.clear();
+    }
+};
+
+/// Keeps the pex objects of finished files, so the next file of the same game reuses
+/// their strings and data buffer instead of allocating new ones.
+/// Not thread safe, each worker has its own pool.
+class PexPool
+{
+public:
+    /// Hands the object back to its pool instead of deleting it.
+    class Recycler
+    {
+    public:
+        Recycler(PexPool *pool = nullptr, const PexGameTraits *traits = nullptr)
+            : m_pool(pool), m_traits(traits) { }
+        void operator ()(PexBase *pex) const;
+
+    private:
+        PexPool *m_pool;
+        const PexGameTraits *m_traits;
+    };
+
+    /// Must not outlive the pool it came from.
+    using Pointer = std::unique_ptr<PexBase, Recycler>;
+
+    PexPool() { }
+    PexPool(const PexPool &) = delete;
+    PexPool & operator =(const PexPool &) = delete;
+
+    /// Same as PexFactory::createUniquePex, but reuses a released object when there is one.
+    Pointer acquire(const PexHeader &pexHeader);
+    Pointer acquire(const PexView &view);
+
+    inline PexWorkspace& getWorkspace() { return m_workspace; }
+
+    /// Number of objects created instead of reused.
+    inline std::size_t getCreatedCount() const { return m_created; }
+
+private:
+    /// Enough for the source, destination and read back copies of a file.
+    static const std::size_t maxFreeCount = 4;
+    /// Buffers grown by a huge file are dropped instead of being kept around.
+    static const std::size_t maxRetainedCapacity = 16 * 1024 * 1024;
+
+    struct FreeEntry
+    {
+        const PexGameTraits *traits;
+        std::unique_ptr<PexBase> pex;
+    };
+
+    std::vector<FreeEntry> m_free;
+    PexWorkspace m_workspace;
+    std::size_t m_created = 0;
+
+    void release(const PexGameTraits *traits, PexBase *pex);
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXPOOL_HPP
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXSCRIPT_HPP
+#define PEXSCRIPT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <boost/utility/string_view.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Nodes of a parsed pex script, everything after the machine name.
+/// Nodes live in a PexArena and strings point into the parsed buffer,
+/// so both have to outlive the script.
+
+/// Fixed size array of arena nodes.
+template <typename T>
+struct PexArray
+{
+    T *items;
+    std::size_t count;
+
+    inline T* begin() const { return items; }
+    inline T* end() const { return items + count; }
+    inline std::size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline T& operator [](std::size_t index) const { return items[index]; }
+};
+
+/// Byte range relative to the start of the parsed buffer.
+struct PexSection
+{
+    std::size_t offset;
+    std::size_t size;
+};
+
+enum class PexValueType : uint8_t
+{
+    none        = 0,
+    identifier  = 1,
+    string      = 2,
+    integer     = 3,
+    real        = 4,
+    boolean     = 5,
+};
+
+/// Variable data, identifiers and strings are string table indexes.
+struct PexValue
+{
+    PexValueType type;
+    union
+    {
+        uint16_t stringIndex;
+        int32_t  integer;
+        float    real;
+        uint8_t  boolean;
+    };
+};
+
+struct PexInstruction
+{
+    uint8_t opcode;
+    /// Fixed arguments, followed by the variable argument count and arguments if the opcode has them.
+    PexArray<PexValue> arguments;
+};
+
+struct PexVariableType
+{
+    uint16_t name;
+    uint16_t type;
+};
+
+struct PexFunction
+{
+    uint16_t returnType;
+    uint16_t docString;
+    uint32_t userFlags;
+    uint8_t  flags;             // 0x01 global, 0x02 native
+    PexArray<PexVariableType> params;
+    PexArray<PexVariableType> locals;
+    PexArray<PexInstruction> instructions;
+};
+
+struct PexNamedFunction
+{
+    uint16_t name;
+    PexFunction function;
+};
+
+struct PexState
+{
+    uint16_t name;
+    PexArray<PexNamedFunction> functions;
+};
+
+struct PexProperty
+{
+    uint16_t name;
+    uint16_t type;
+    uint16_t docString;
+    uint32_t userFlags;
+    uint8_t  flags;             // 0x01 read, 0x02 write, 0x04 auto var
+    uint16_t autoVarName;
+    PexFunction readHandler;
+    PexFunction writeHandler;
+};
+
+struct PexVariable
+{
+    uint16_t name;
+    uint16_t typeName;
+    uint32_t userFlags;
+    PexValue value;
+    uint8_t  constFlag;         // Fallout 4
+};
+
+/// Fallout 4
+struct PexStructMember
+{
+    uint16_t name;
+    uint16_t typeName;
+    uint32_t userFlags;
+    PexValue value;
+    uint8_t  constFlag;
+    uint16_t docString;
+};
+
+/// Fallout 4
+struct PexStruct
+{
+    uint16_t name;
+    PexArray<PexStructMember> members;
+};
+
+struct PexObject
+{
+    uint16_t name;
+    uint16_t parentClassName;
+    uint16_t docString;
+    uint8_t  constFlag;         // Fallout 4
+    uint32_t userFlags;
+    uint16_t autoStateName;
+    PexArray<PexStruct> structs;    // Fallout 4
+    PexArray<PexVariable> variables;
+    PexArray<PexProperty> properties;
+    PexArray<PexState> states;
+    /// Object data, without the name and size fields.
+    PexSection section;
+};
+
+struct PexDebugFunction
+{
+    uint16_t objectName;
+    uint16_t stateName;
+    uint16_t functionName;
+    uint8_t  functionType;      // 0 method, 1 getter, 2 setter
+    PexArray<uint16_t> lineNumbers;
+};
+
+/// Fallout 4
+struct PexPropertyGroup
+{
+    uint16_t objectName;
+    uint16_t groupName;
+    uint16_t docString;
+    uint32_t userFlags;
+    PexArray<uint16_t> propertyNames;
+};
+
+/// Fallout 4
+struct PexStructOrder
+{
+    uint16_t objectName;
+    uint16_t orderName;
+    PexArray<uint16_t> names;
+};
+
+struct PexDebugInfo
+{
+    bool hasDebugInfo;
+    uint64_t modificationTime;
+    PexArray<PexDebugFunction> functions;
+    PexArray<PexPropertyGroup> propertyGroups;  // Fallout 4
+    PexArray<PexStructOrder> structOrders;      // Fallout 4
+};
+
+struct PexUserFlag
+{
+    uint16_t name;
+    uint8_t  flagIndex;
+};
+
+struct PexScript
+{
+    PexArray<boost::string_view> strings;
+    PexDebugInfo debugInfo;
+    PexArray<PexUserFlag> userFlags;
+    PexArray<PexObject> objects;
+
+    PexSection stringTableSection;
+    PexSection debugInfoSection;
+    PexSection userFlagsSection;
+    PexSection objectsSection;
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXSCRIPT_HPP
@@ -20,43 +20,24 @@
  * IN THE SOFTWARE.
  */
 #include <afk/fileformats/pex/pexskyrim.hpp>
-#include <afk/fileformats/pex/gameid.hpp>
-#include <keeg/common/enums.hpp>
+#include <afk/fileformats/pex/pexgametraits.hpp>
 #include <ctime>
 
 namespace afk { namespace fileformats { namespace pex {
 
-namespace kc = keeg::common;
-
 /// Skyrim pex files use Big-Endian ordering for numbers.
-PexSkyrim::PexSkyrim() : PexBase(keeg::endian::Order::big)
+PexSkyrim::PexSkyrim() : PexBase(skyrimTraits.endianOrder)
 {
-    m_header.magic = UINT32_C(0xFA57C0DE);
-    m_header.majorVersion = 3;
-    m_header.minorVersion = 2;
-    m_header.gameId = kc::enumToIntegral(GameID::skyrim);
+    m_header.magic = skyrimTraits.magic;
+    m_header.majorVersion = skyrimTraits.majorVersion;
+    m_header.minorVersion = skyrimTraits.minorVersion;
+    m_header.gameId = skyrimTraits.gameId;
     m_header.compilationTime = static_cast<uint64_t>(time(NULL));
 }
 
 bool PexSkyrim::isPex(const PexHeader &pexHeader)
 {
-    try
-    {
-        if ((pexHeader.magic == UINT32_C(0xFA57C0DE)) &&
-                (pexHeader.majorVersion == 3) &&
-                (pexHeader.minorVersion == 2) &&
-                (pexHeader.gameId == kc::enumToIntegral(GameID::skyrim)))
-        {
-            return true;
-        }
-    }
-    catch (const std::exception &ex)
-    {
-        std::cerr << ex.what() << std::endl;
-        return false;
-    }
-
-    return false;
+    return skyrimTraits.matches(pexHeader);
 }
 
 } // pex namespace
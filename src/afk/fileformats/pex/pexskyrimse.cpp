@@ -20,43 +20,24 @@
  * IN THE SOFTWARE.
  */
 #include <afk/fileformats/pex/pexskyrimse.hpp>
-#include <afk/fileformats/pex/gameid.hpp>
-#include <keeg/common/enums.hpp>
+#include <afk/fileformats/pex/pexgametraits.hpp>
 #include <ctime>
 
 namespace afk { namespace fileformats { namespace pex {
 
-namespace kc = keeg::common;
-
 /// SkyrimSE pex files use Big-Endian ordering for numbers.
-PexSkyrimSE::PexSkyrimSE() : PexBase(keeg::endian::Order::big)
+PexSkyrimSE::PexSkyrimSE() : PexBase(skyrimSETraits.endianOrder)
 {
-    m_header.magic = UINT32_C(0xFA57C0DE);
-    m_header.majorVersion = 3;
-    m_header.minorVersion = 1;
-    m_header.gameId = kc::enumToIntegral<GameID>(GameID::skyrimSE);
+    m_header.magic = skyrimSETraits.magic;
+    m_header.majorVersion = skyrimSETraits.majorVersion;
+    m_header.minorVersion = skyrimSETraits.minorVersion;
+    m_header.gameId = skyrimSETraits.gameId;
     m_header.compilationTime = static_cast<uint64_t>(time(NULL));
 }
 
 bool PexSkyrimSE::isPex(const PexHeader &pexHeader)
 {
-    try
-    {
-        if ((pexHeader.magic == UINT32_C(0xFA57C0DE)) &&
-                (pexHeader.majorVersion == 3) &&
-                (pexHeader.minorVersion == 1) &&
-                (pexHeader.gameId == kc::enumToIntegral<GameID>(GameID::skyrimSE)))
-        {
-            return true;
-        }
-    }
-    catch (const std::exception &ex)
-    {
-        std::cerr << ex.what() << std::endl;
-        return false;
-    }
-
-    return false;
+    return skyrimSETraits.matches(pexHeader);
 }
 
 } // pex namespace
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/pex/pexstringtable.hpp>
+#include <unordered_map>
+
+namespace afk { namespace fileformats { namespace pex {
+
+namespace ke = keeg::endian;
+
+namespace {
+
+/// 64-bit FNV-1a, boost::string_view has no std::hash.
+struct StringViewHash
+{
+    std::size_t operator ()(const boost::string_view &value) const
+    {
+        uint64_t hash = UINT64_C(0xcbf29ce484222325);
+        for (char c: value)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= UINT64_C(0x100000001b3);
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+} // anonymous namespace
+
+const uint32_t PexStringTable::noIndex;
+
+PexStringTable::PexStringTable(const PexScript &script, const uint8_t *data,
+                               const std::vector<uint32_t> &stringReferences,
+                               keeg::endian::Order endianOrder)
+    : m_script(script), m_stringReferences(stringReferences), m_endianOrder(endianOrder)
+{
+    const std::size_t count = script.strings.size();
+    std::vector<bool> isReferenced(count, false);
+    for (uint32_t reference: stringReferences)
+    {
+        uint16_t index = readIndex(data + reference);
+        if (index >= count)
+        {
+            m_valid = false;
+            return;
+        }
+        isReferenced[index] = true;
+    }
+
+    /// Interned in the original order, so an already compact table maps onto itself.
+    std::unordered_map<boost::string_view, uint32_t, StringViewHash> interned;
+    interned.reserve(count);
+    m_strings.reserve(count);
+    m_newIndexes.assign(count, noIndex);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (!isReferenced[i])
+            continue;
+
+        auto inserted = interned.emplace(script.strings[i], static_cast<uint32_t>(m_strings.size()));
+        if (inserted.second)
+            m_strings.push_back(script.strings[i]);
+        m_newIndexes[i] = inserted.first->second;
+    }
+}
+
+bool PexStringTable::isCompact() const
+{
+    if (m_strings.size() != m_script.strings.size())
+        return false;
+
+    for (std::size_t i = 0; i < m_newIndexes.size(); ++i)
+        if (m_newIndexes[i] != i)
+            return false;
+
+    return true;
+}
+
+bool PexStringTable::write(const uint8_t *data, std::size_t size, std::vector<uint8_t> &out) const
+{
+    const PexSection &table = m_script.stringTableSection;
+    if (!m_valid || (table.offset + table.size > size))
+        return false;
+
+    out.clear();
+    out.reserve(size);
+    out.insert(std::end(out), data, data + table.offset);
+
+    auto writeLength = [this, &out](std::size_t length)
+    {
+        uint8_t bytes[2];
+        writeIndex(bytes, static_cast<uint16_t>(length));
+        out.insert(std::end(out), bytes, bytes + sizeof(bytes));
+    };
+
+    writeLength(m_strings.size());
+    for (const auto &string: m_strings)
+    {
+        writeLength(string.size());
+        out.insert(std::end(out), string.begin(), string.end());
+    }
+
+    /// Everything after the table moves by the same amount.
+    const std::size_t tableEnd = table.offset + table.size;
+    const std::size_t newTableEnd = out.size();
+    out.insert(std::end(out), data + tableEnd, data + size);
+
+    for (uint32_t reference: m_stringReferences)
+    {
+        if (reference < tableEnd)
+            return false;
+
+        uint16_t index = readIndex(data + reference);
+        writeIndex(out.data() + (reference - tableEnd) + newTableEnd,
+                   static_cast<uint16_t>(m_newIndexes[index]));
+    }
+
+    return true;
+}
+
+uint16_t PexStringTable::readIndex(const uint8_t *data) const
+{
+    return (m_endianOrder == ke::Order::big)
+            ? static_cast<uint16_t>((data[0] << 8) | data[1])
+            : static_cast<uint16_t>((data[1] << 8) | data[0]);
+}
+
+void PexStringTable::writeIndex(uint8_t *data, uint16_t index) const
+{
+    if (m_endianOrder == ke::Order::big)
+    {
+        data[0] = static_cast<uint8_t>(index >> 8);
+        data[1] = static_cast<uint8_t>(index);
+    }
+    else
+    {
+        data[0] = static_cast<uint8_t>(index);
+        data[1] = static_cast<uint8_t>(index >> 8);
+    }
+}
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
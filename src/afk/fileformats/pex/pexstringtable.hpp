@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXSTRINGTABLE_HPP
+#define PEXSTRINGTABLE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+#include <afk/fileformats/pex/pexscript.hpp>
+#include <keeg/endian/conversion.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Compacted string table of a parsed script: unreferenced strings are dropped
+/// and duplicates merged, keeping the order of the first occurrence.
+class PexStringTable
+{
+public:
+    /// data is the buffer the script was parsed from, with the string references
+    /// reported by PexParser::parse.
+    PexStringTable(const PexScript &script, const uint8_t *data,
+                   const std::vector<uint32_t> &stringReferences,
+                   keeg::endian::Order endianOrder);
+
+    /// False if a reference points past the end of the string table.
+    inline bool isValid() const { return m_valid; }
+    /// True if compacting wouldn't change anything.
+    bool isCompact() const;
+    inline std::size_t size() const { return m_strings.size(); }
+
+    /// Writes the data with the new string table and every reference remapped.
+    bool write(const uint8_t *data, std::size_t size, std::vector<uint8_t> &out) const;
+
+private:
+    const PexScript &m_script;
+    const std::vector<uint32_t> &m_stringReferences;
+    keeg::endian::Order m_endianOrder;
+    bool m_valid = true;
+    std::vector<boost::string_view> m_strings;
+    /// New index of every old string, or noIndex if it's unreferenced.
+    std::vector<uint32_t> m_newIndexes;
+
+    static const uint32_t noIndex = UINT32_MAX;
+
+    uint16_t readIndex(const uint8_t *data) const;
+    void writeIndex(uint8_t *data, uint16_t index) const;
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXSTRINGTABLE_HPP
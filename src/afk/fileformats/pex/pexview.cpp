@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/fileformats/pex/pexview.hpp>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace afk { namespace fileformats { namespace pex {
+
+namespace ke = keeg::endian;
+
+PexView::PexView(const std::string &fileName)
+{
+    open(fileName);
+}
+
+PexView::PexView(const uint8_t *data, std::size_t size)
+{
+    open(data, size);
+}
+
+bool PexView::open(const std::string &fileName)
+{
+    close();
+    try
+    {
+        m_file.open(fileName);
+        if (m_file.is_open())
+        {
+            m_begin = reinterpret_cast<const uint8_t*>(m_file.data());
+            m_size = m_file.size();
+            return parse();
+        }
+    }
+    catch (const std::exception &)
+    {
+        /// Empty files can't be mapped, they aren't pex files either.
+        close();
+        return false;
+    }
+
+    return false;
+}
+
+bool PexView::open(const uint8_t *data, std::size_t size)
+{
+    close();
+    m_begin = data;
+    m_size = size;
+    return parse();
+}
+
+namespace {
+
+/// Reads the start of a file with a single call, without mapping or buffering it.
+class HeaderFile
+{
+public:
+    explicit HeaderFile(const std::string &fileName)
+    {
+#if defined(_WIN32)
+        m_file.open(fileName, std::ios::binary);
+#else
+        m_fd = ::open(fileName.c_str(), O_RDONLY);
+#endif
+    }
+
+    ~HeaderFile()
+    {
+#if !defined(_WIN32)
+        if (m_fd >= 0)
+            ::close(m_fd);
+#endif
+    }
+
+    HeaderFile(const HeaderFile &) = delete;
+    HeaderFile & operator =(const HeaderFile &) = delete;
+
+    bool isOpen() const
+    {
+#if defined(_WIN32)
+        return m_file.is_open();
+#else
+        return m_fd >= 0;
+#endif
+    }
+
+    /// Reads up to size bytes from the start of the file, returns the count read.
+    std::size_t read(uint8_t *data, std::size_t size)
+    {
+#if defined(_WIN32)
+        m_file.clear();
+        m_file.seekg(0, std::ios::beg);
+        m_file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<std::size_t>(m_file.gcount());
+#else
+        std::size_t count = 0;
+        while (count < size)
+        {
+            ssize_t result = ::pread(m_fd, data + count, size - count, static_cast<off_t>(count));
+            if (result <= 0)
+                break;
+            count += static_cast<std::size_t>(result);
+        }
+        return count;
+#endif
+    }
+
+private:
+#if defined(_WIN32)
+    std::ifstream m_file;
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // anonymous namespace
+
+bool PexView::openHeader(const std::string &fileName, std::vector<uint8_t> &buffer)
+{
+    /// Enough for the names of nearly every file, longer ones are read again.
+    const std::size_t initialSize = 512;
+    const std::size_t maxSize = sizeof(PexHeader) + 3 * (sizeof(uint16_t) + UINT16_MAX);
+
+    close();
+    HeaderFile file(fileName);
+    if (!file.isOpen())
+        return false;
+
+    for (std::size_t size = initialSize; ; size = std::min(size * 2, maxSize))
+    {
+        buffer.resize(size);
+        std::size_t count = file.read(buffer.data(), size);
+
+        m_begin = buffer.data();
+        m_size = count;
+        if (parse())
+        {
+            /// Only the names were read, there's no data to hand out.
+            m_size = m_headerStringsSize;
+            return true;
+        }
+
+        /// The whole file was read, or it isn't a pex file at all.
+        PexHeader header;
+        if ((count < size) || (size == maxSize) || !header.read(buffer.data(), count))
+            break;
+    }
+
+    close();
+    return false;
+}
+
+void PexView::close()
+{
+    if (m_file.is_open())
+        m_file.close();
+
+    m_begin = nullptr;
+    m_size = 0;
+    m_valid = false;
+    m_headerStringsSize = 0;
+    m_sourceFileName.clear();
+    m_userName.clear();
+    m_machineName.clear();
+}
+
+bool PexView::parse()
+{
+    m_valid = false;
+    if (!m_header.read(m_begin, m_size))
+        return false;
+
+    /// The magic number is stored in the file's byte order.
+    m_endianOrder = (m_begin[0] == 0xFA) ? ke::Order::big : ke::Order::little;
+
+    std::size_t offset = sizeof(PexHeader);
+    if (readWString(offset, m_sourceFileName)
+            && readWString(offset, m_userName)
+            && readWString(offset, m_machineName))
+    {
+        m_headerStringsSize = offset;
+        m_valid = true;
+    }
+
+    return m_valid;
+}
+
+bool PexView::readWString(std::size_t &offset, boost::string_view &value) const
+{
+    if ((m_size < sizeof(uint16_t)) || (offset > m_size - sizeof(uint16_t)))
+        return false;
+
+    const uint8_t *p = m_begin + offset;
+    std::size_t length = (m_endianOrder == ke::Order::big)
+            ? ((static_cast<std::size_t>(p[0]) << 8) | p[1])
+            : ((static_cast<std::size_t>(p[1]) << 8) | p[0]);
+    offset += sizeof(uint16_t);
+
+    if (length > m_size - offset)
+        return false;
+
+    value = boost::string_view(reinterpret_cast<const char*>(m_begin + offset), length);
+    offset += length;
+    return true;
+}
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
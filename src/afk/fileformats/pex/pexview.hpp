@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXVIEW_HPP
+#define PEXVIEW_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/utility/string_view.hpp>
+#include <afk/fileformats/pex/pexheader.hpp>
+#include <keeg/endian/conversion.hpp>
+
+namespace afk { namespace fileformats { namespace pex {
+
+/// Read only view of a pex file that's memory mapped or already in memory.
+/// The strings and the data point directly into the buffer, nothing is copied.
+class PexView
+{
+public:
+    PexView() { }
+    explicit PexView(const std::string &fileName);
+    PexView(const uint8_t *data, std::size_t size);
+
+    /// Maps the whole file and parses it.
+    bool open(const std::string &fileName);
+    /// Parses a buffer owned by the caller, it must outlive the view.
+    bool open(const uint8_t *data, std::size_t size);
+    /// Reads only the header and the names into the buffer, usually a few hundred bytes.
+    /// The buffer must outlive the view, and the data after the names is left empty.
+    bool openHeader(const std::string &fileName, std::vector<uint8_t> &buffer);
+    void close();
+
+    /// Getters
+    inline bool isValid() const { return m_valid; }
+    inline keeg::endian::Order getEndianOrder() const { return m_endianOrder; }
+    inline const PexHeader& getPexHeader() const { return m_header; }
+    inline boost::string_view getSourceFileName() const { return m_sourceFileName; }
+    inline boost::string_view getUserName() const { return m_userName; }
+    inline boost::string_view getMachineName() const { return m_machineName; }
+
+    /// The whole file.
+    inline const uint8_t* getFileData() const { return m_begin; }
+    inline std::size_t getFileSize() const { return m_size; }
+
+    /// Everything after the machine name.
+    inline const uint8_t* getData() const { return m_begin + m_headerStringsSize; }
+    inline std::size_t getDataSize() const { return m_size - m_headerStringsSize; }
+    inline std::size_t getHeaderStringsSize() const { return m_headerStringsSize; }
+
+protected:
+    boost::iostreams::mapped_file_source m_file;
+    const uint8_t *m_begin = nullptr;
+    std::size_t m_size = 0;
+    bool m_valid = false;
+
+    keeg::endian::Order m_endianOrder = keeg::endian::Order::big;
+    PexHeader m_header{};
+    boost::string_view m_sourceFileName;
+    boost::string_view m_userName;
+    boost::string_view m_machineName;
+    std::size_t m_headerStringsSize = 0;
+
+    bool parse();
+    bool readWString(std::size_t &offset, boost::string_view &value) const;
+};
+
+} // pex namespace
+} // fileformats namespace
+} // afk namespace
+
+#endif // PEXVIEW_HPP
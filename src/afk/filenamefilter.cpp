@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/filenamefilter.hpp>
+#include <algorithm>
+#include <iterator>
+
+namespace afk {
+
+namespace {
+
+inline char toLower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/// Same as boost::filesystem::path::extension, from the last dot on.
+inline boost::string_view getExtension(boost::string_view fileName)
+{
+    std::size_t dot = fileName.rfind('.');
+    return (dot == boost::string_view::npos) ? boost::string_view() : fileName.substr(dot);
+}
+
+bool iequals(boost::string_view lhs, boost::string_view rhs)
+{
+    return (lhs.size() == rhs.size())
+            && std::equal(std::begin(lhs), std::end(lhs), std::begin(rhs),
+                          [](char l, char r) { return toLower(l) == toLower(r); });
+}
+
+} // anonymous namespace
+
+void FileNameFilter::include(const std::string &pattern)
+{
+    if (isGlob(pattern))
+    {
+        m_includeGlobs.push_back(pattern);
+        return;
+    }
+
+    /// "pex" is taken to mean ".pex".
+    std::string extension = (pattern.empty() || (pattern.front() == '.')) ? pattern : '.' + pattern;
+    std::transform(std::begin(extension), std::end(extension), std::begin(extension), toLower);
+
+    std::uint64_t packed;
+    if (packExtension(extension, packed))
+        m_shortExtensions.push_back(packed);
+    else
+        m_longExtensions.push_back(extension);
+}
+
+void FileNameFilter::exclude(const std::string &pattern)
+{
+    m_excludeGlobs.push_back(pattern);
+}
+
+bool FileNameFilter::matches(boost::string_view fileName) const
+{
+    if (isExcluded(fileName))
+        return false;
+
+    const boost::string_view extension = getExtension(fileName);
+
+    std::uint64_t packed;
+    if (packExtension(extension, packed))
+    {
+        if (std::find(std::begin(m_shortExtensions), std::end(m_shortExtensions), packed)
+                != std::end(m_shortExtensions))
+            return true;
+    }
+    else if (std::any_of(std::begin(m_longExtensions), std::end(m_longExtensions),
+                         [&extension](const std::string &valid) { return iequals(extension, valid); }))
+    {
+        return true;
+    }
+
+    return std::any_of(std::begin(m_includeGlobs), std::end(m_includeGlobs),
+                       [&fileName](const std::string &glob) { return matchGlob(glob, fileName); });
+}
+
+bool FileNameFilter::isExcluded(boost::string_view name) const
+{
+    return std::any_of(std::begin(m_excludeGlobs), std::end(m_excludeGlobs),
+                       [&name](const std::string &glob) { return matchGlob(glob, name); });
+}
+
+bool FileNameFilter::isGlob(boost::string_view pattern)
+{
+    return pattern.find_first_of("*?") != boost::string_view::npos;
+}
+
+bool FileNameFilter::matchGlob(boost::string_view pattern, boost::string_view name)
+{
+    /// Greedy match that backtracks to the last *, linear for a single * and never recursive.
+    std::size_t p = 0, n = 0;
+    std::size_t star = boost::string_view::npos, retry = 0;
+
+    while (n < name.size())
+    {
+        if ((p < pattern.size()) && ((pattern[p] == '?') || (toLower(pattern[p]) == toLower(name[n]))))
+        {
+            ++p;
+            ++n;
+        }
+        else if ((p < pattern.size()) && (pattern[p] == '*'))
+        {
+            star = p++;
+            retry = n;
+        }
+        else if (star != boost::string_view::npos)
+        {
+            p = star + 1;
+            n = ++retry;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while ((p < pattern.size()) && (pattern[p] == '*'))
+        ++p;
+
+    return p == pattern.size();
+}
+
+bool FileNameFilter::packExtension(boost::string_view extension, std::uint64_t &packed)
+{
+    if (extension.size() > sizeof(packed))
+        return false;
+
+    /// Names can't hold a NUL, so the zero padding keeps ".pe" apart from ".pex".
+    packed = 0;
+    for (std::size_t i = 0; i < extension.size(); ++i)
+        packed |= static_cast<std::uint64_t>(static_cast<unsigned char>(toLower(extension[i]))) << (i * 8);
+
+    return true;
+}
+
+} // afk namespace
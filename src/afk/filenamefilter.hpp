@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef FILENAMEFILTER_HPP
+#define FILENAMEFILTER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace afk {
+
+/// Decides from a file name alone whether it's processed, compiled once from the options so
+/// the folder walk can test every entry without allocating. Matching ignores ASCII case.
+/// Extensions of up to 8 bytes are packed into integers, so most names cost one comparison.
+/// Globs support * and ?, and are matched against the name, not the whole path.
+class FileNameFilter
+{
+public:
+    /// Adds an extension such as ".pex", or a glob such as "Quest*.pex" matched against the name.
+    void include(const std::string &pattern);
+    /// Adds a glob, matching files and folders are skipped even when included.
+    void exclude(const std::string &pattern);
+
+    /// Whether a file with this name is processed.
+    bool matches(boost::string_view fileName) const;
+    /// Whether a folder with this name is skipped, along with everything below it.
+    bool isExcluded(boost::string_view name) const;
+
+    static bool isGlob(boost::string_view pattern);
+    static bool matchGlob(boost::string_view pattern, boost::string_view name);
+
+private:
+    /// Lower cased extensions, dot included, packed little end first.
+    std::vector<std::uint64_t> m_shortExtensions;
+    /// Lower cased extensions too long to pack.
+    std::vector<std::string> m_longExtensions;
+    std::vector<std::string> m_includeGlobs;
+    std::vector<std::string> m_excludeGlobs;
+
+    static bool packExtension(boost::string_view extension, std::uint64_t &packed);
+};
+
+} // afk namespace
+
+#endif // FILENAMEFILTER_HPP
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/filewatcher.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace afk {
+
+namespace bf = boost::filesystem;
+
+FileWatcher::FileWatcher(const DirectoryWalker::Filter &folderFilter) : m_folderFilter(folderFilter)
+{ }
+
+FileWatcher::~FileWatcher()
+{
+    close();
+}
+
+bool FileWatcher::addFolder(const std::string &folder, bool recursive)
+{
+    return isOpen() && watchFolder(folder, recursive, nullptr);
+}
+
+#ifdef __linux__
+
+namespace {
+
+const std::size_t eventBufferSize = 64 * 1024;
+/// A steady stream of writes doesn't hold a batch back for longer than this many debounce times.
+const int maxDebounceCount = 10;
+
+} // anonymous namespace
+
+bool FileWatcher::open()
+{
+    close();
+
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+    {
+        std::cerr << "Unable to start watching: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_buffer.resize(eventBufferSize);
+    return true;
+}
+
+void FileWatcher::close()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+
+    m_fd = -1;
+    m_folders.clear();
+}
+
+bool FileWatcher::watchFolder(const std::string &folder, bool recursive, std::vector<std::string> *files)
+{
+    /// Compilers either write the file in place or move a finished one in.
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR;
+    if (recursive)
+        mask |= IN_CREATE;
+
+    int wd = ::inotify_add_watch(m_fd, folder.c_str(), mask);
+    if (wd < 0)
+    {
+        std::cerr << "Unable to watch folder: " << folder << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_folders[wd] = WatchedFolder{folder, recursive};
+    if (!recursive && !files)
+        return true;
+
+    /// The watch is in place before the folder is listed, so nothing written meanwhile is missed.
+    try
+    {
+        for (bf::directory_iterator it(folder), end; it != end; ++it)
+        {
+            if (bf::is_directory(it->symlink_status()))
+            {
+                if (recursive && (!m_folderFilter || m_folderFilter(it->path().filename().string())))
+                    watchFolder(it->path().string(), true, files);
+            }
+            else if (files && bf::is_regular_file(it->status()))
+            {
+                files->push_back(it->path().string());
+            }
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+    }
+
+    return true;
+}
+
+bool FileWatcher::readEvents(std::vector<std::string> &paths)
+{
+    for (;;)
+    {
+        ssize_t size = ::read(m_fd, m_buffer.data(), m_buffer.size());
+        if (size < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EINTR))
+                return true;
+
+            std::cerr << "Unable to read file changes: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        for (ssize_t offset = 0; offset < size; )
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event*>(m_buffer.data() + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                std::cerr << "Too many changes at once, some files may have been missed." << std::endl;
+                continue;
+            }
+
+            auto it = m_folders.find(event->wd);
+            if (it == std::end(m_folders))
+                continue;
+
+            /// The folder was removed or unmounted.
+            if (event->mask & IN_IGNORED)
+            {
+                m_folders.erase(it);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            const bool recursive = it->second.recursive;
+            const std::string &folder = it->second.path;
+            const std::string path = ((folder.back() == '/') ? folder : folder + '/') + event->name;
+
+            if (event->mask & IN_ISDIR)
+            {
+                /// Files can be written to a new folder before its watch is added, so those are listed.
+                if (recursive && (!m_folderFilter || m_folderFilter(event->name)))
+                    watchFolder(path, true, &paths);
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                paths.push_back(path);
+            }
+        }
+    }
+}
+
+bool FileWatcher::wait(std::vector<std::string> &paths, std::chrono::milliseconds timeout,
+                       std::chrono::milliseconds debounce)
+{
+    if (!isOpen())
+        return false;
+
+    pollfd events{m_fd, POLLIN, 0};
+    int ready = ::poll(&events, 1, static_cast<int>(timeout.count()));
+    if (ready <= 0)
+        return (ready == 0) || (errno == EINTR);
+
+    const std::size_t first = paths.size();
+    const auto start = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        if (!readEvents(paths))
+            return false;
+
+        if (std::chrono::steady_clock::now() - start >= debounce * maxDebounceCount)
+            break;
+
+        ready = ::poll(&events, 1, static_cast<int>(debounce.count()));
+        if ((ready < 0) && (errno != EINTR))
+            return false;
+        if (ready <= 0)
+            break;
+    }
+
+    /// A file is often closed more than once, or closed and then moved.
+    std::sort(std::begin(paths) + first, std::end(paths));
+    paths.erase(std::unique(std::begin(paths) + first, std::end(paths)), std::end(paths));
+    return true;
+}
+
+bool FileWatcher::isAvailable()
+{
+    return true;
+}
+
+#else
+
+bool FileWatcher::open()
+{
+    std::cerr << "Unable to start watching: only supported on Linux" << std::endl;
+    return false;
+}
+
+void FileWatcher::close()
+{ }
+
+bool FileWatcher::watchFolder(const std::string &, bool, std::vector<std::string> *)
+{
+    return false;
+}
+
+bool FileWatcher::readEvents(std::vector<std::string> &)
+{
+    return false;
+}
+
+bool FileWatcher::wait(std::vector<std::string> &, std::chrono::milliseconds, std::chrono::milliseconds)
+{
+    return false;
+}
+
+bool FileWatcher::isAvailable()
+{
+    return false;
+}
+
+#endif
+
+} // afk namespace
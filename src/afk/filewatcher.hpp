@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <afk/directorywalker.hpp>
+
+namespace afk {
+
+/// Reports the files that are written or moved into a set of folders, through inotify.
+/// Events are collected until the folders stay quiet for the debounce time, so a file
+/// written in several steps is reported once. Only available on Linux, elsewhere open fails.
+/// Not thread safe.
+class FileWatcher
+{
+public:
+    /// Subfolders whose name the filter rejects aren't watched.
+    explicit FileWatcher(const DirectoryWalker::Filter &folderFilter = DirectoryWalker::Filter());
+    ~FileWatcher();
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher & operator =(const FileWatcher &) = delete;
+
+    bool open();
+    void close();
+    inline bool isOpen() const { return m_fd >= 0; }
+
+    /// Watches the folder, and with recursive every subfolder, including the ones created later.
+    /// Returns false when the folder itself can't be watched.
+    bool addFolder(const std::string &folder, bool recursive);
+
+    /// Waits up to timeout for changes, then until none come in for the debounce time.
+    /// The files found are added to paths, once each. A signal ends the wait early.
+    bool wait(std::vector<std::string> &paths, std::chrono::milliseconds timeout,
+              std::chrono::milliseconds debounce);
+
+    static bool isAvailable();
+
+private:
+    struct WatchedFolder
+    {
+        std::string path;
+        bool recursive;
+    };
+
+    int m_fd = -1;
+    DirectoryWalker::Filter m_folderFilter;
+    /// Folders by watch descriptor.
+    std::unordered_map<int, WatchedFolder> m_folders;
+    std::vector<char> m_buffer;
+
+    /// The files already in a folder are added to files, when given.
+    bool watchFolder(const std::string &folder, bool recursive, std::vector<std::string> *files);
+    bool readEvents(std::vector<std::string> &paths);
+};
+
+} // afk namespace
+
+#endif // FILEWATCHER_HPP
@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/ioring.hpp>
+
+#if defined(AFK_IO_URING) && defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace afk {
+
+namespace {
+
+/// Longest chain submitted at once is open, write, fsync, read, close.
+const unsigned queueDepth = 8;
+/// The first read of a file is at least this big, most scripts fit.
+const std::size_t minimumReadSize = 64 * 1024;
+/// Every chain opens its file into the same registered slot.
+const uint32_t fileSlot = 0;
+
+int setup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int enter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int registerRing(int ringFd, unsigned opcode, void *arg, unsigned count)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+
+/// Direct descriptors need Linux 5.15, the first release that also has IORING_OP_LINKAT.
+bool hasOperations(int ringFd)
+{
+    const unsigned opCount = 256;
+    std::vector<uint8_t> buffer(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op));
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (registerRing(ringFd, IORING_REGISTER_PROBE, probe, opCount) < 0)
+        return false;
+
+    for (unsigned op: { IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE,
+                        IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT, IORING_OP_LINKAT })
+    {
+        if ((op > probe->last_op) || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+
+    return true;
+}
+
+/// The fields match io_uring_prep_rw in liburing.
+void prepare(void *entry, uint8_t opcode, int fd, const void *addr, uint32_t len, uint64_t offset)
+{
+    io_uring_sqe *sqe = static_cast<io_uring_sqe*>(entry);
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->len = len;
+    sqe->off = offset;
+}
+
+/// Later operations of a chain run even if an earlier one fails, so the file is always closed.
+void link(void *entry)
+{
+    static_cast<io_uring_sqe*>(entry)->flags |= IOSQE_IO_HARDLINK;
+}
+
+void prepareOpen(void *entry, const std::string &fileName, int flags, uint32_t mode)
+{
+    prepare(entry, IORING_OP_OPENAT, AT_FDCWD, fileName.c_str(), mode, 0);
+    io_uring_sqe *sqe = static_cast<io_uring_sqe*>(entry);
+    /// Direct descriptors are never inherited, the kernel rejects O_CLOEXEC for them.
+    sqe->open_flags = static_cast<uint32_t>(flags);
+    sqe->file_index = fileSlot + 1;
+}
+
+void prepareFixed(void *entry, uint8_t opcode, void *buffer, std::size_t size, uint64_t offset)
+{
+    prepare(entry, opcode, static_cast<int>(fileSlot), buffer, static_cast<uint32_t>(size), offset);
+    static_cast<io_uring_sqe*>(entry)->flags |= IOSQE_FIXED_FILE;
+}
+
+void prepareClose(void *entry)
+{
+    prepare(entry, IORING_OP_CLOSE, 0, nullptr, 0, 0);
+    static_cast<io_uring_sqe*>(entry)->file_index = fileSlot + 1;
+}
+
+template <typename T>
+T* ringField(void *ring, uint32_t offset)
+{
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+} // anonymous namespace
+
+IoRing::~IoRing()
+{
+    close();
+}
+
+bool IoRing::open()
+{
+    if (isOpen())
+        return true;
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ringFd = setup(queueDepth, &params);
+    if (ringFd < 0)
+        return false;
+
+    m_ringFd = ringFd;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !hasOperations(m_ringFd))
+    {
+        close();
+        return false;
+    }
+
+    m_ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                          params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    m_ring = ::mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_ringFd, IORING_OFF_SQ_RING);
+    m_entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_entries = ::mmap(nullptr, m_entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       m_ringFd, IORING_OFF_SQES);
+    if ((m_ring == MAP_FAILED) || (m_entries == MAP_FAILED))
+    {
+        close();
+        return false;
+    }
+
+    m_sqHead = ringField<uint32_t>(m_ring, params.sq_off.head);
+    m_sqTail = ringField<uint32_t>(m_ring, params.sq_off.tail);
+    m_sqMask = ringField<uint32_t>(m_ring, params.sq_off.ring_mask);
+    m_sqArray = ringField<uint32_t>(m_ring, params.sq_off.array);
+    m_cqHead = ringField<uint32_t>(m_ring, params.cq_off.head);
+    m_cqTail = ringField<uint32_t>(m_ring, params.cq_off.tail);
+    m_cqMask = ringField<uint32_t>(m_ring, params.cq_off.ring_mask);
+    m_cqes = ringField<io_uring_cqe>(m_ring, params.cq_off.cqes);
+
+    /// One empty slot for the direct descriptors, files never get a normal descriptor.
+    int32_t slots[] = { -1 };
+    if (registerRing(m_ringFd, IORING_REGISTER_FILES, slots, 1) < 0)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void IoRing::close()
+{
+    if ((m_entries != nullptr) && (m_entries != MAP_FAILED))
+        ::munmap(m_entries, m_entriesSize);
+    if ((m_ring != nullptr) && (m_ring != MAP_FAILED))
+        ::munmap(m_ring, m_ringSize);
+    if (m_ringFd >= 0)
+        ::close(m_ringFd);
+
+    m_entries = nullptr;
+    m_ring = nullptr;
+    m_ringFd = -1;
+    m_pending = 0;
+}
+
+bool IoRing::readFile(const std::string &fileName, std::vector<uint8_t> &buffer, std::size_t &size, uint32_t &mode)
+{
+    if (!isOpen())
+        return false;
+
+    struct statx fileStatus;
+    std::memset(&fileStatus, 0, sizeof(fileStatus));
+    if (buffer.size() < minimumReadSize)
+        buffer.resize(minimumReadSize);
+
+    void *statEntry = nextEntry();
+    prepare(statEntry, IORING_OP_STATX, AT_FDCWD, fileName.c_str(), STATX_MODE | STATX_SIZE,
+            reinterpret_cast<uint64_t>(&fileStatus));
+    link(statEntry);
+    void *openEntry = nextEntry();
+    prepareOpen(openEntry, fileName, O_RDONLY, 0);
+    link(openEntry);
+    void *readEntry = nextEntry();
+    prepareFixed(readEntry, IORING_OP_READ, buffer.data(), buffer.size(), 0);
+    link(readEntry);
+    prepareClose(nextEntry());
+
+    if (!submitAndWait() || (m_results[0] < 0) || (m_results[1] < 0) || (m_results[2] < 0))
+        return false;
+
+    mode = fileStatus.stx_mode & 07777;
+    size = static_cast<std::size_t>(m_results[2]);
+
+    /// Bigger than the buffer, grow it and read the rest now that the size is known.
+    if ((size == buffer.size()) && (fileStatus.stx_size > size))
+    {
+        buffer.resize(static_cast<std::size_t>(fileStatus.stx_size));
+        openEntry = nextEntry();
+        prepareOpen(openEntry, fileName, O_RDONLY, 0);
+        link(openEntry);
+        readEntry = nextEntry();
+        prepareFixed(readEntry, IORING_OP_READ, buffer.data() + size, buffer.size() - size, size);
+        link(readEntry);
+        prepareClose(nextEntry());
+
+        if (!submitAndWait() || (m_results[0] < 0) || (m_results[1] < 0))
+            return false;
+        size += static_cast<std::size_t>(m_results[1]);
+    }
+
+    /// A short read would be anonymized and written back as a truncated script.
+    return size == fileStatus.stx_size;
+}
+
+bool IoRing::writeFile(const std::string &fileName, const std::vector<uint8_t> &data, uint32_t mode,
+                       std::vector<uint8_t> *readBack)
+{
+    if (!isOpen())
+        return false;
+
+    void *openEntry = nextEntry();
+    prepareOpen(openEntry, fileName, O_RDWR | O_CREAT | O_TRUNC, mode);
+    link(openEntry);
+    void *writeEntry = nextEntry();
+    prepareFixed(writeEntry, IORING_OP_WRITE, const_cast<uint8_t*>(data.data()), data.size(), 0);
+    link(writeEntry);
+    /// The data has to be on the disk before the file is renamed over the original.
+    void *syncEntry = nextEntry();
+    prepareFixed(syncEntry, IORING_OP_FSYNC, nullptr, 0, 0);
+    static_cast<io_uring_sqe*>(syncEntry)->fsync_flags = IORING_FSYNC_DATASYNC;
+    link(syncEntry);
+    if (readBack)
+    {
+        /// One byte more than was written, so anything left over shows up.
+        readBack->resize(data.size() + 1);
+        void *readEntry = nextEntry();
+        prepareFixed(readEntry, IORING_OP_READ, readBack->data(), readBack->size(), 0);
+        link(readEntry);
+    }
+    prepareClose(nextEntry());
+
+    if (!submitAndWait())
+        return false;
+
+    bool isWritten = (m_results[0] >= 0) && (static_cast<std::size_t>(m_results[1]) == data.size())
+            && (m_results[2] >= 0);
+    if (readBack)
+    {
+        isWritten = isWritten && (m_results[3] >= 0);
+        readBack->resize(isWritten ? static_cast<std::size_t>(m_results[3]) : 0);
+    }
+
+    return isWritten && (m_results.back() >= 0);
+}
+
+bool IoRing::rename(const std::string &from, const std::string &to)
+{
+    if (!isOpen())
+        return false;
+
+    prepare(nextEntry(), IORING_OP_RENAMEAT, AT_FDCWD, from.c_str(), static_cast<uint32_t>(AT_FDCWD),
+            reinterpret_cast<uint64_t>(to.c_str()));
+
+    return submitAndWait() && (m_results[0] >= 0);
+}
+
+bool IoRing::isAvailable()
+{
+    return true;
+}
+
+void* IoRing::nextEntry()
+{
+    uint32_t index = (*m_sqTail + m_pending) & *m_sqMask;
+    io_uring_sqe *sqe = static_cast<io_uring_sqe*>(m_entries) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = m_pending;
+    m_sqArray[index] = index;
+    ++m_pending;
+    return sqe;
+}
+
+bool IoRing::submitAndWait()
+{
+    unsigned count = m_pending;
+    m_pending = 0;
+    m_results.assign(count, -ECANCELED);
+
+    __atomic_store_n(m_sqTail, *m_sqTail + count, __ATOMIC_RELEASE);
+
+    unsigned toSubmit = count;
+    unsigned completed = 0;
+    while (completed < count)
+    {
+        int status = enter(m_ringFd, toSubmit, count - completed, IORING_ENTER_GETEVENTS);
+        if ((status < 0) && (errno != EINTR))
+        {
+            /// The submitted entries still point at the caller's buffers and this stack, they have
+            /// to complete before returning. Closing the ring drops the ones never submitted.
+            unsigned submitted = count - toSubmit;
+            while ((completed < submitted)
+                   && ((enter(m_ringFd, 0, submitted - completed, IORING_ENTER_GETEVENTS) >= 0) || (errno == EINTR)))
+            {
+                completed += reapCompletions(count);
+            }
+            close();
+            return false;
+        }
+
+        if (status > 0)
+            toSubmit -= std::min(toSubmit, static_cast<unsigned>(status));
+
+        completed += reapCompletions(count);
+    }
+
+    return true;
+}
+
+unsigned IoRing::reapCompletions(unsigned count)
+{
+    uint32_t head = *m_cqHead;
+    uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    unsigned reaped = 0;
+    for (; head != tail; ++head, ++reaped)
+    {
+        const io_uring_cqe &cqe = static_cast<io_uring_cqe*>(m_cqes)[head & *m_cqMask];
+        if (cqe.user_data < count)
+            m_results[cqe.user_data] = cqe.res;
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+} // afk namespace
+
+#else
+
+namespace afk {
+
+IoRing::~IoRing() { }
+bool IoRing::open() { return false; }
+void IoRing::close() { }
+
+bool IoRing::readFile(const std::string &, std::vector<uint8_t> &, std::size_t &, uint32_t &)
+{
+    return false;
+}
+
+bool IoRing::writeFile(const std::string &, const std::vector<uint8_t> &, uint32_t, std::vector<uint8_t> *)
+{
+    return false;
+}
+
+bool IoRing::rename(const std::string &, const std::string &)
+{
+    return false;
+}
+
+bool IoRing::isAvailable()
+{
+    return false;
+}
+
+void* IoRing::nextEntry() { return nullptr; }
+bool IoRing::submitAndWait() { return false; }
+unsigned IoRing::reapCompletions(unsigned) { return 0; }
+
+} // afk namespace
+
+#endif
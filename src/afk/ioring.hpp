@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef IORING_HPP
+#define IORING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace afk {
+
+/// File I/O through io_uring. Each call submits a whole chain of linked operations
+/// (stat, open, read, write, close) with a single system call, instead of one per step.
+/// Only built with qmake "CONFIG+=io_uring" on Linux, elsewhere open always fails
+/// and the callers fall back to the standard file I/O.
+/// Not thread safe, each worker has its own ring.
+class IoRing
+{
+public:
+    IoRing() { }
+    ~IoRing();
+    IoRing(const IoRing &) = delete;
+    IoRing & operator =(const IoRing &) = delete;
+
+    /// Sets up the ring, false when io_uring isn't built in, is blocked, or the kernel
+    /// lacks one of the operations (Linux 5.15 or later is needed).
+    bool open();
+    void close();
+    inline bool isOpen() const { return m_ringFd >= 0; }
+
+    /// Reads the whole file into the start of buffer, size gets its size and mode its permissions.
+    /// The buffer only grows, so a worker reuses it from one file to the next without clearing it.
+    bool readFile(const std::string &fileName, std::vector<uint8_t> &buffer, std::size_t &size, uint32_t &mode);
+    /// Creates or truncates the file, writes data and syncs it to the disk. When readBack is
+    /// given the file is read back into it before it's closed, in the same submission.
+    bool writeFile(const std::string &fileName, const std::vector<uint8_t> &data, uint32_t mode,
+                   std::vector<uint8_t> *readBack = nullptr);
+    bool rename(const std::string &from, const std::string &to);
+
+    /// Whether the application was built with io_uring support.
+    static bool isAvailable();
+
+private:
+    int m_ringFd = -1;
+
+    /// Submission and completion rings, shared with the kernel.
+    void *m_ring = nullptr;
+    std::size_t m_ringSize = 0;
+    void *m_entries = nullptr;
+    std::size_t m_entriesSize = 0;
+
+    uint32_t *m_sqHead = nullptr;
+    uint32_t *m_sqTail = nullptr;
+    uint32_t *m_sqMask = nullptr;
+    uint32_t *m_sqArray = nullptr;
+    uint32_t *m_cqHead = nullptr;
+    uint32_t *m_cqTail = nullptr;
+    uint32_t *m_cqMask = nullptr;
+    void *m_cqes = nullptr;
+
+    /// Results of the last chain, in submission order.
+    std::vector<int32_t> m_results;
+    unsigned m_pending = 0;
+
+    void *nextEntry();
+    /// Submits the pending entries and waits for all of them. On an error the ring is closed,
+    /// once the entries already submitted are done.
+    bool submitAndWait();
+    /// Stores the results of the completed entries, returns how many there were.
+    unsigned reapCompletions(unsigned count);
+};
+
+} // afk namespace
+
+#endif // IORING_HPP
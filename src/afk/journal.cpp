@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "journal.hpp"
+#include <afk/filecopy.hpp>
+#include <boost/filesystem.hpp>
+#include <exception>
+#include <iostream>
+
+namespace afk {
+
+namespace bf = boost::filesystem;
+
+bool Journal::open(const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try
+    {
+        m_fileName = fileName;
+        m_entries.clear();
+        m_unsynced = 0;
+
+        {
+            std::ifstream journalFile(m_fileName);
+            std::string entry;
+            while (std::getline(journalFile, entry))
+                if (!entry.empty())
+                    m_entries.insert(entry);
+        }
+
+        m_file.open(m_fileName, std::ios::out | std::ios::app);
+        return m_file.is_open();
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+}
+
+bool Journal::contains(const std::string &entry) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.find(entry) != std::end(m_entries);
+}
+
+bool Journal::add(const std::string &entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return false;
+
+    m_file << entry << '\n' << std::flush;
+    m_entries.insert(entry);
+    if (!m_file)
+        return false;
+
+    return (++m_unsynced < syncInterval) || syncNow();
+}
+
+bool Journal::sync()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_file.is_open() || (m_unsynced == 0) || syncNow();
+}
+
+bool Journal::syncNow()
+{
+    m_unsynced = 0;
+    return afk::syncFile(m_fileName);
+}
+
+bool Journal::remove()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try
+    {
+        if (m_file.is_open())
+            m_file.close();
+
+        m_entries.clear();
+        return bf::remove(m_fileName);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+}
+
+} // afk namespace
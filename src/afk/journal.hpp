@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace afk {
+
+/// Append only list of finished files, so an interrupted run can pick up where it stopped.
+/// Each line is the absolute path of a file that was completely processed.
+class Journal
+{
+public:
+    Journal() { }
+
+    /// Loads the files finished by an earlier run and opens the journal for appending.
+    bool open(const std::string &fileName);
+    inline bool isOpen() const { return m_file.is_open(); }
+
+    bool contains(const std::string &entry) const;
+    /// Records a finished file, flushed right away so it survives the process dying.
+    /// Every syncInterval entries the journal is also synced, so it survives a power loss.
+    bool add(const std::string &entry);
+    /// Waits until every entry is on the disk.
+    bool sync();
+
+    /// Closes the journal and deletes it, once the whole run has finished.
+    bool remove();
+
+private:
+    std::string m_fileName;
+    std::ofstream m_file;
+    std::unordered_set<std::string> m_entries;
+    /// Entries added since the last sync.
+    std::size_t m_unsynced = 0;
+    mutable std::mutex m_mutex;
+
+    /// Losing the last few entries only means processing those files again.
+    static constexpr std::size_t syncInterval = 64;
+
+    bool syncNow();
+};
+
+} // afk namespace
+
+#endif // JOURNAL_HPP
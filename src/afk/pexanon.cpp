@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/pexanon.h>
+#include <afk/pexanonymizer.hpp>
+#include "version.hpp"
+#include <cstdlib>
+#include <sstream>
+
+using namespace afk;
+using namespace afk::fileformats::pex;
+
+namespace {
+
+/// Keeps the objects and scratch buffers of earlier calls on the same thread.
+struct ThreadState
+{
+    PexPool pool;
+};
+
+ThreadState& getThreadState()
+{
+    static thread_local ThreadState state;
+    return state;
+}
+
+pexanon_status toStatus(PexAnonymizer::Status status)
+{
+    switch (status) {
+    case PexAnonymizer::Status::anonymized:
+        return PEXANON_ANONYMIZED;
+    case PexAnonymizer::Status::clean:
+        return PEXANON_CLEAN;
+    case PexAnonymizer::Status::unrecognized:
+        return PEXANON_UNRECOGNIZED;
+    case PexAnonymizer::Status::failed:
+    default:
+        return PEXANON_FAILED;
+    }
+}
+
+} // anonymous namespace
+
+void pexanon_default_options(pexanon_options *opts)
+{
+    if (!opts)
+        return;
+
+    PexAnonymizer::Options options;
+    opts->mask = options.mask;
+    opts->strip_debug = options.stripDebug;
+    opts->compact_strings = options.compactStrings;
+    opts->mask_names = options.maskNames;
+}
+
+pexanon_status pexanon_process_buffer(const uint8_t *in, size_t len, pexanon_buffer *out,
+                                      const pexanon_options *opts)
+{
+    if (!out)
+        return PEXANON_INVALID_ARGUMENT;
+
+    out->data = nullptr;
+    out->size = 0;
+    if (!in && (len > 0))
+        return PEXANON_INVALID_ARGUMENT;
+
+    /// Nothing may be thrown across the C boundary.
+    try
+    {
+        PexAnonymizer::Options options;
+        if (opts)
+        {
+            options.mask = opts->mask;
+            options.stripDebug = opts->strip_debug != 0;
+            options.compactStrings = opts->compact_strings != 0;
+            options.maskNames = opts->mask_names != 0;
+        }
+
+        /// The script is written straight into the caller's buffer. It's allocated with malloc,
+        /// so it can be released without the C++ runtime of the caller.
+        auto allocate = [out](std::size_t size) {
+            out->data = static_cast<uint8_t*>(std::malloc(size));
+            out->size = out->data ? size : 0;
+            return out->data;
+        };
+
+        ThreadState &state = getThreadState();
+        std::ostringstream log;
+        PexAnonymizer::Status status = PexAnonymizer(options).anonymize("", in, len, allocate, state.pool, log);
+        if (status != PexAnonymizer::Status::anonymized)
+        {
+            pexanon_free_buffer(out);
+            return toStatus(status);
+        }
+
+        return PEXANON_ANONYMIZED;
+    }
+    catch (...)
+    {
+        pexanon_free_buffer(out);
+        return PEXANON_FAILED;
+    }
+}
+
+void pexanon_free_buffer(pexanon_buffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    std::free(buffer->data);
+    buffer->data = nullptr;
+    buffer->size = 0;
+}
+
+const char* pexanon_version(void)
+{
+    return version::VERSION_STRING.c_str();
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXANON_H
+#define PEXANON_H
+
+/*
+ * C API of the anonymizer, for tools that want to anonymize scripts they
+ * already hold in memory. Every function may be called from several threads
+ * at once, each thread reuses its own buffers between calls.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(PEXANON_SHARED)
+#  ifdef PEXANON_BUILD
+#    define PEXANON_API __declspec(dllexport)
+#  else
+#    define PEXANON_API __declspec(dllimport)
+#  endif
+#elif defined(PEXANON_SHARED)
+#  define PEXANON_API __attribute__((visibility("default")))
+#else
+#  define PEXANON_API
+#endif
+
+typedef enum pexanon_status
+{
+    PEXANON_ANONYMIZED = 0,     /* out holds the anonymized script. */
+    PEXANON_CLEAN,              /* Nothing to change, out is left empty. */
+    PEXANON_UNRECOGNIZED,       /* Not a Skyrim, Skyrim SE or Fallout 4 script. */
+    PEXANON_FAILED,             /* The result didn't validate, or out of memory. */
+    PEXANON_INVALID_ARGUMENT
+} pexanon_status;
+
+typedef struct pexanon_options
+{
+    char mask;                  /* Character to mask computer and user names. */
+    int strip_debug;            /* Remove the debug info. */
+    int compact_strings;        /* Remove unused and duplicate strings from the string table. */
+    int mask_names;             /* Also mask the names in the strings after the header. */
+} pexanon_options;
+
+typedef struct pexanon_buffer
+{
+    uint8_t *data;
+    size_t size;
+} pexanon_buffer;
+
+/* Same defaults as the command line: mask with '*', nothing else. */
+PEXANON_API void pexanon_default_options(pexanon_options *opts);
+
+/*
+ * Anonymizes the script in in. On PEXANON_ANONYMIZED out receives a new buffer
+ * that must be released with pexanon_free_buffer, otherwise out is set empty.
+ * opts may be NULL for the defaults.
+ */
+PEXANON_API pexanon_status pexanon_process_buffer(const uint8_t *in, size_t len, pexanon_buffer *out,
+                                                  const pexanon_options *opts);
+
+PEXANON_API void pexanon_free_buffer(pexanon_buffer *buffer);
+
+/* Version of the library, for example "1.1.0". */
+PEXANON_API const char* pexanon_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PEXANON_H */
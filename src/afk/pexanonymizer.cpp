@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <afk/pexanonymizer.hpp>
+#include <afk/fileformats/pex/gameid.hpp>
+#include <afk/fileformats/pex/pexparser.hpp>
+#include <afk/fileformats/pex/pexstringtable.hpp>
+#include <keeg/common/enums.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <algorithm>
+#include <iterator>
+
+namespace afk {
+
+using namespace afk::fileformats::pex;
+namespace bio = boost::iostreams;
+
+PexAnonymizer::Status PexAnonymizer::anonymize(const std::string &name, const uint8_t *data, std::size_t size,
+                                               std::vector<uint8_t> &out, PexPool &pool, std::ostream &log) const
+{
+    return anonymize(name, data, size, [&out](std::size_t destSize) {
+        out.resize(destSize);
+        return out.data();
+    }, pool, log);
+}
+
+PexAnonymizer::Status PexAnonymizer::anonymize(const std::string &name, const uint8_t *data, std::size_t size,
+                                               const Allocator &allocate, PexPool &pool, std::ostream &log) const
+{
+    PexView view(data, size);
+    PexPool::Pointer pex = pool.acquire(view);
+    if (pex && !pex->read(view))
+        pex = nullptr;
+
+    if (!pex)
+    {
+        log << "Unrecognized file type: " << name << std::endl;
+        return Status::unrecognized;
+    }
+
+    if (isAnonymized(*pex) && !needsDataRewrite(view, pool.getWorkspace()))
+    {
+        if (m_options.verbose)
+            log << "Already anonymized: " << name << std::endl;
+        return Status::clean;
+    }
+
+    PexNameScanner nameScanner;
+    std::size_t nameCount = isAnonymized(*pex) ? 0 : scanNames(view, nameScanner);
+    bool isMaskingNames = m_options.maskNames && (nameCount > 0);
+
+    log << name << std::endl;
+    if (m_options.verbose)
+        log << *pex << std::endl;
+    if (nameCount > 0)
+        log << "User or machine name found in the data: " << std::dec << nameCount << " time(s)" << std::endl;
+
+    anonymize(*pex);
+    if (m_options.stripDebug || m_options.compactStrings || isMaskingNames)
+        rewriteData(name, *pex, isMaskingNames ? &nameScanner : nullptr, nameCount, pool.getWorkspace(), log);
+
+    /// The size is known up front, so the result is written once, straight into its buffer.
+    const std::vector<uint8_t> &expectedData = pex->getData();
+    const std::size_t headerStringsSize = pex->getHeaderStringsSize();
+    const std::size_t destSize = headerStringsSize + expectedData.size();
+    uint8_t *dest = allocate(destSize);
+    if (!dest)
+    {
+        log << "Unable to allocate " << std::dec << destSize << " bytes: " << name << std::endl;
+        return Status::failed;
+    }
+
+    bio::stream<bio::array_sink> headerStream(reinterpret_cast<char*>(dest), headerStringsSize);
+    if ((pex->writeHeaderStrings(headerStream) != headerStringsSize) || !headerStream.flush())
+    {
+        log << "Unable to write: " << name << std::endl;
+        return Status::failed;
+    }
+    std::copy(std::begin(expectedData), std::end(expectedData), dest + headerStringsSize);
+
+    /// Parse the result again before it's handed back.
+    PexView destView(dest, destSize);
+    bool isValid = destView.isValid()
+            && (destView.getPexHeader() == pex->getPexHeader())
+            && (destView.getUserName() == pex->getUserName())
+            && (destView.getMachineName() == pex->getMachineName())
+            && (destView.getDataSize() == expectedData.size())
+            && std::equal(std::begin(expectedData), std::end(expectedData), destView.getData());
+    if (!isValid)
+    {
+        log << "Unable to validate data skipping: " << name << std::endl;
+        return Status::failed;
+    }
+
+    return Status::anonymized;
+}
+
+void PexAnonymizer::anonymize(PexBase &pex) const
+{
+    /// Fill the machine name with mask characters.
+    pex.setMachineName(std::string(pex.getMachineName().size(), m_options.mask));
+    /// Fill the user name with mask characters.
+    pex.setUserName(std::string(pex.getUserName().size(), m_options.mask));
+
+    pex.setSourceFileName(getAnonymousSourceFileName(pex));
+}
+
+std::string PexAnonymizer::getAnonymousSourceFileName(const PexBase &pex) const
+{
+    /// Strip the path from script names in fallout 4 pex's.
+    /// No idea why Bethesda in their infinte wisdom decided to add the path from the
+    /// temporary folder to the source file?
+    /// The path is always a Windows one, so split it by hand, boost only knows '/' outside Windows.
+    if (pex.getPexHeader().gameId == keeg::common::enumToIntegral(GameID::fallout4))
+    {
+        const std::string sourceFileName = pex.getSourceFileName();
+        std::size_t separator = sourceFileName.find_last_of("\\/:");
+        return (separator == std::string::npos) ? sourceFileName : sourceFileName.substr(separator + 1);
+    }
+
+    return pex.getSourceFileName();
+}
+
+bool PexAnonymizer::isAnonymized(const PexBase &pex) const
+{
+    const std::string userName = pex.getUserName();
+    const std::string machineName = pex.getMachineName();
+    const char mask = m_options.mask;
+
+    return (std::count(std::begin(userName), std::end(userName), mask) == static_cast<std::ptrdiff_t>(userName.size()))
+            && (std::count(std::begin(machineName), std::end(machineName), mask) == static_cast<std::ptrdiff_t>(machineName.size()))
+            && (getAnonymousSourceFileName(pex) == pex.getSourceFileName());
+}
+
+std::size_t PexAnonymizer::scanNames(const PexView &view, PexNameScanner &scanner) const
+{
+    /// The names can also turn up after the header, in doc strings and paths.
+    scanner.addName(view.getUserName());
+    scanner.addName(view.getMachineName());
+    return scanner.scan(view.getData(), view.getDataSize());
+}
+
+bool PexAnonymizer::needsDataRewrite(const PexView &view, PexWorkspace &workspace) const
+{
+    if (!m_options.stripDebug && !m_options.compactStrings)
+        return false;
+
+    workspace.reset();
+    PexScript script;
+    if (!PexParser::parse(view.getData(), view.getDataSize(), view.getEndianOrder(),
+                          view.getPexHeader(), workspace.arena, script, &workspace.stringReferences))
+    {
+        /// It'll fail the same way when rewriting, there's nothing to do.
+        return false;
+    }
+
+    if (m_options.stripDebug && script.debugInfo.hasDebugInfo)
+        return true;
+
+    if (m_options.compactStrings)
+    {
+        PexStringTable stringTable(script, view.getData(), workspace.stringReferences, view.getEndianOrder());
+        return stringTable.isValid() && !stringTable.isCompact();
+    }
+
+    return false;
+}
+
+void PexAnonymizer::rewriteData(const std::string &name, PexBase &pex, const PexNameScanner *nameScanner,
+                                std::size_t nameCount, PexWorkspace &workspace, std::ostream &log) const
+{
+    std::size_t size = pex.getData().size();
+
+    /// Masked first, so compacting can merge the strings that end up the same.
+    if (nameScanner)
+    {
+        std::size_t masked = pex.maskNames(*nameScanner, m_options.mask, workspace);
+        if (masked < nameCount)
+            log << "Names outside of strings left as is: " << std::dec << (nameCount - masked) << std::endl;
+    }
+
+    if (m_options.stripDebug && !pex.stripDebugInfo(workspace))
+        log << "Unable to parse debug info, leaving it in: " << name << std::endl;
+
+    if (m_options.compactStrings && !pex.compactStringTable(workspace))
+        log << "Unable to parse string references, leaving the strings as is: " << name << std::endl;
+
+    if (m_options.verbose)
+        log << "Data size: " << std::dec << size << " -> " << pex.getData().size() << std::endl;
+}
+
+} // afk namespace
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PEXANONYMIZER_HPP
+#define PEXANONYMIZER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexnamescanner.hpp>
+#include <afk/fileformats/pex/pexpool.hpp>
+#include <afk/fileformats/pex/pexview.hpp>
+
+namespace afk {
+
+/// Anonymizes single pex files in memory, without touching the disk.
+/// This is the part of the application that other tools link against, see pexanon.h for the C API.
+/// Calls with different pools may run at the same time.
+class PexAnonymizer
+{
+public:
+    struct Options
+    {
+        /// Character to mask computer and user names.
+        char mask = '*';
+        /// Remove the debug info.
+        bool stripDebug = false;
+        /// Remove unused and duplicate strings from the string table.
+        bool compactStrings = false;
+        /// Also mask the names found in the strings after the header.
+        bool maskNames = false;
+        /// Adds the script and data sizes to the log.
+        bool verbose = false;
+    };
+
+    enum class Status
+    {
+        anonymized,
+        clean,          // Nothing to change, the output is left empty.
+        unrecognized,
+        failed,
+    };
+
+    /// Gets the size of the result and returns a buffer of at least that size, nullptr if it can't.
+    using Allocator = std::function<uint8_t*(std::size_t size)>;
+
+    PexAnonymizer() { }
+    explicit PexAnonymizer(const Options &options) : m_options(options) { }
+
+    inline const Options& getOptions() const { return m_options; }
+    inline void setOptions(const Options &options) { m_options = options; }
+
+    /// Anonymizes a whole pex file, out only holds the result when it's anonymized.
+    /// The result is parsed again and compared before it's returned. Messages go to log.
+    Status anonymize(const std::string &name, const uint8_t *data, std::size_t size,
+                     std::vector<uint8_t> &out, fileformats::pex::PexPool &pool, std::ostream &log) const;
+    /// Same, but the result is written straight into the buffer from allocate,
+    /// so embedders can hand it on without copying it.
+    Status anonymize(const std::string &name, const uint8_t *data, std::size_t size,
+                     const Allocator &allocate, fileformats::pex::PexPool &pool, std::ostream &log) const;
+
+    /// Masks the names and fixes the source file name in the header strings.
+    void anonymize(fileformats::pex::PexBase &pex) const;
+    std::string getAnonymousSourceFileName(const fileformats::pex::PexBase &pex) const;
+    bool isAnonymized(const fileformats::pex::PexBase &pex) const;
+
+    /// Adds the user and machine name of the view to the scanner and counts them in the data.
+    std::size_t scanNames(const fileformats::pex::PexView &view, fileformats::pex::PexNameScanner &scanner) const;
+    /// Whether stripping or compacting would change the data.
+    bool needsDataRewrite(const fileformats::pex::PexView &view, fileformats::pex::PexWorkspace &workspace) const;
+    /// Names are only masked when a scanner is given, nameCount is how many it found in the data.
+    void rewriteData(const std::string &name, fileformats::pex::PexBase &pex,
+                     const fileformats::pex::PexNameScanner *nameScanner, std::size_t nameCount,
+                     fileformats::pex::PexWorkspace &workspace, std::ostream &log) const;
+
+private:
+    Options m_options;
+};
+
+} // afk namespace
+
+#endif // PEXANONYMIZER_HPP
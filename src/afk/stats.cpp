@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "stats.hpp"
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+namespace afk {
+
+constexpr std::size_t Stats::histogramBuckets;
+
+namespace {
+
+const char *stageNames[] = {
+    "traversal", "detection", "scan", "backup_copy", "temp_copy", "read", "rewrite",
+    "write", "read_back", "compare", "replace", "file"
+};
+
+const char *counterNames[] = {
+    "found", "anonymized", "already_anonymized", "unrecognized", "failed",
+    "leaking", "unchanged", "already_processed", "reflinked"
+};
+
+uint64_t toNanoseconds(Stats::Clock::duration duration)
+{
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return (nanoseconds > 0) ? static_cast<uint64_t>(nanoseconds) : 0;
+}
+
+} // anonymous namespace
+
+Stats::StageTimer::StageTimer(Stats &stats, Stage stage, uint64_t bytes)
+    : m_stats(stats), m_stage(stage), m_bytes(bytes)
+{
+    if (m_stats.isEnabled())
+        m_start = Clock::now();
+}
+
+Stats::StageTimer::~StageTimer()
+{
+    if (m_stats.isEnabled())
+        m_stats.record(m_stage, Clock::now() - m_start - m_excluded, m_bytes);
+}
+
+void Stats::record(Stage stage, Clock::duration duration, uint64_t bytes)
+{
+    if (!m_enabled)
+        return;
+
+    uint64_t nanoseconds = toNanoseconds(duration);
+    StageStats &stats = m_stages[index(stage)];
+    stats.count++;
+    stats.nanoseconds += nanoseconds;
+    stats.bytes += bytes;
+    stats.histogram[getBucket(nanoseconds)]++;
+
+    uint64_t maxNanoseconds = stats.maxNanoseconds;
+    while ((nanoseconds > maxNanoseconds) && !stats.maxNanoseconds.compare_exchange_weak(maxNanoseconds, nanoseconds))
+    { }
+}
+
+bool Stats::write(const std::string &fileName) const
+{
+    try
+    {
+        if (fileName == "-")
+        {
+            writeJson(std::cout);
+            return bool(std::cout);
+        }
+
+        std::ofstream statsFile(fileName, std::ios::trunc);
+        const std::string csvExtension{".csv"};
+        bool isCsv = (fileName.size() >= csvExtension.size())
+                && (fileName.compare(fileName.size() - csvExtension.size(), csvExtension.size(), csvExtension) == 0);
+        if (isCsv)
+            writeCsv(statsFile);
+        else
+            writeJson(statsFile);
+
+        return bool(statsFile);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+}
+
+void Stats::writeJson(std::ostream &out) const
+{
+    out << "{\n  \"wall_ns\": " << getWallTime() << ",\n  \"counters\": {";
+    for (std::size_t i = 0; i < index(Counter::count); ++i)
+        out << (i ? ", " : "") << '"' << counterNames[i] << "\": " << m_counters[i];
+
+    out << "},\n  \"histogram_bucket_us\": [";
+    for (std::size_t i = 0; i + 1 < histogramBuckets; ++i)
+        out << (i ? ", " : "") << (UINT64_C(1) << i);
+    out << ", null],\n  \"stages\": {";
+
+    for (std::size_t i = 0; i < index(Stage::count); ++i)
+    {
+        const StageStats &stats = m_stages[i];
+        out << (i ? "," : "") << "\n    \"" << stageNames[i] << "\": {"
+            << "\"count\": " << stats.count
+            << ", \"total_ns\": " << stats.nanoseconds
+            << ", \"max_ns\": " << stats.maxNanoseconds
+            << ", \"bytes\": " << stats.bytes
+            << ", \"histogram\": [";
+        for (std::size_t bucket = 0; bucket < histogramBuckets; ++bucket)
+            out << (bucket ? ", " : "") << stats.histogram[bucket];
+        out << "]}";
+    }
+
+    out << "\n  }\n}" << std::endl;
+}
+
+void Stats::writeCsv(std::ostream &out) const
+{
+    out << "kind,name,count,total_ns,max_ns,bytes";
+    for (std::size_t i = 0; i + 1 < histogramBuckets; ++i)
+        out << ",lt_" << (UINT64_C(1) << i) << "us";
+    out << ",longer\n";
+
+    /// Rows without a histogram leave its columns empty.
+    const std::string noHistogram(histogramBuckets, ',');
+    uint64_t wallTime = getWallTime();
+    out << "wall,run,1," << wallTime << ',' << wallTime << ",0" << noHistogram << '\n';
+    for (std::size_t i = 0; i < index(Counter::count); ++i)
+        out << "counter," << counterNames[i] << ',' << m_counters[i] << ",0,0,0" << noHistogram << '\n';
+
+    for (std::size_t i = 0; i < index(Stage::count); ++i)
+    {
+        const StageStats &stats = m_stages[i];
+        out << "stage," << stageNames[i] << ',' << stats.count << ',' << stats.nanoseconds
+            << ',' << stats.maxNanoseconds << ',' << stats.bytes;
+        for (std::size_t bucket = 0; bucket < histogramBuckets; ++bucket)
+            out << ',' << stats.histogram[bucket];
+        out << '\n';
+    }
+
+    out.flush();
+}
+
+const char* Stats::getName(Stage stage)
+{
+    return stageNames[index(stage)];
+}
+
+const char* Stats::getName(Counter counter)
+{
+    return counterNames[index(counter)];
+}
+
+std::size_t Stats::getBucket(uint64_t nanoseconds)
+{
+    uint64_t microseconds = nanoseconds / 1000;
+    std::size_t bucket = 0;
+    while ((bucket + 1 < histogramBuckets) && (microseconds >= (UINT64_C(1) << bucket)))
+        ++bucket;
+    return bucket;
+}
+
+uint64_t Stats::getWallTime() const
+{
+    return m_enabled ? toNanoseconds(Clock::now() - m_start) : 0;
+}
+
+} // afk namespace
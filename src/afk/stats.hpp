@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace afk {
+
+/// Wall time, bytes and latency histograms for each stage of a run, plus file counters.
+/// Recording is lock free, so workers can share one instance.
+class Stats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Stage : std::size_t
+    {
+        traversal,      // Searching the folders, once per source folder.
+        detection,      // Mapping the file and recognizing the game.
+        scan,           // Searching the data for the user and machine names.
+        backupCopy,     // Copying the original to the backup file.
+        tempCopy,       // Copying the original to the temporary file.
+        read,           // Reading the temporary file.
+        rewrite,        // Parsing and rewriting the data.
+        write,          // Writing the anonymized file.
+        readBack,       // Reading the written file again.
+        compare,        // Comparing the written data to the original.
+        replace,        // Renaming the temporary file over the original.
+        file,           // Everything done for one file.
+        count
+    };
+
+    enum class Counter : std::size_t
+    {
+        found,              // Files handed to the workers.
+        anonymized,
+        alreadyAnonymized,
+        unrecognized,
+        failed,
+        leaking,            // Still has real names, only counted by --check.
+        unchanged,          // Skipped thanks to the cache.
+        alreadyProcessed,   // Skipped thanks to the journal.
+        reflinked,          // Backup and temporary copies that share the data of the original.
+        count
+    };
+
+    /// Bucket i counts latencies under 2^i microseconds, the last one everything longer.
+    static constexpr std::size_t histogramBuckets = 32;
+
+    /// Times a stage from construction to destruction, does nothing if stats are disabled.
+    class StageTimer
+    {
+    public:
+        StageTimer(Stats &stats, Stage stage, uint64_t bytes = 0);
+        ~StageTimer();
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator =(const StageTimer&) = delete;
+
+        inline void addBytes(uint64_t bytes) { m_bytes += bytes; }
+        /// Leaves time spent waiting on something else out of the stage.
+        inline void exclude(Clock::duration duration) { m_excluded += duration; }
+
+    private:
+        Stats &m_stats;
+        Stage m_stage;
+        uint64_t m_bytes;
+        Clock::time_point m_start;
+        Clock::duration m_excluded{0};
+    };
+
+    Stats() { }
+
+    inline void enable() { m_enabled = true; m_start = Clock::now(); }
+    inline bool isEnabled() const { return m_enabled; }
+
+    void record(Stage stage, Clock::duration duration, uint64_t bytes = 0);
+    inline void increment(Counter counter) { if (m_enabled) m_counters[index(counter)]++; }
+
+    /// Files ending with .csv get CSV, anything else JSON. "-" writes JSON to stdout.
+    bool write(const std::string &fileName) const;
+    void writeJson(std::ostream &out) const;
+    void writeCsv(std::ostream &out) const;
+
+    static const char* getName(Stage stage);
+    static const char* getName(Counter counter);
+
+private:
+    struct StageStats
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> nanoseconds{0};
+        std::atomic<uint64_t> maxNanoseconds{0};
+        std::atomic<uint64_t> bytes{0};
+        std::array<std::atomic<uint64_t>, histogramBuckets> histogram{};
+    };
+
+    bool m_enabled = false;
+    Clock::time_point m_start;
+    std::array<StageStats, static_cast<std::size_t>(Stage::count)> m_stages;
+    std::array<std::atomic<uint64_t>, static_cast<std::size_t>(Counter::count)> m_counters{};
+
+    template <typename T>
+    static constexpr std::size_t index(T value) { return static_cast<std::size_t>(value); }
+    static std::size_t getBucket(uint64_t nanoseconds);
+    uint64_t getWallTime() const;
+};
+
+} // afk namespace
+
+#endif // STATS_HPP
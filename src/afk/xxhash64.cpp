@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "xxhash64.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace afk {
+
+namespace {
+
+const uint64_t prime1 = UINT64_C(11400714785074694791);
+const uint64_t prime2 = UINT64_C(14029467366897019727);
+const uint64_t prime3 = UINT64_C(1609587929392839161);
+const uint64_t prime4 = UINT64_C(9650029242287828579);
+const uint64_t prime5 = UINT64_C(2870177450012600261);
+
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t *data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t round(uint64_t lane, uint64_t input)
+{
+    lane += input * prime2;
+    lane = rotateLeft(lane, 31);
+    return lane * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t hash, uint64_t lane)
+{
+    hash ^= round(0, lane);
+    return hash * prime1 + prime4;
+}
+
+/// The four lanes are independent, so the compiler can keep them all in flight.
+inline const uint8_t* processStripes(uint64_t *lanes, const uint8_t *data, const uint8_t *end)
+{
+    uint64_t lane0 = lanes[0], lane1 = lanes[1], lane2 = lanes[2], lane3 = lanes[3];
+    while (end - data >= 32)
+    {
+        lane0 = round(lane0, read64(data));
+        lane1 = round(lane1, read64(data + 8));
+        lane2 = round(lane2, read64(data + 16));
+        lane3 = round(lane3, read64(data + 24));
+        data += 32;
+    }
+    lanes[0] = lane0; lanes[1] = lane1; lanes[2] = lane2; lanes[3] = lane3;
+    return data;
+}
+
+} // anonymous namespace
+
+void XxHash64::reset(uint64_t seed)
+{
+    m_seed = seed;
+    m_lanes[0] = seed + prime1 + prime2;
+    m_lanes[1] = seed + prime2;
+    m_lanes[2] = seed;
+    m_lanes[3] = seed - prime1;
+    m_bufferSize = 0;
+    m_totalSize = 0;
+}
+
+void XxHash64::update(const void *data, std::size_t size)
+{
+    const uint8_t *current = static_cast<const uint8_t*>(data);
+    const uint8_t *end = current + size;
+    m_totalSize += size;
+
+    /// Finish the stripe left over from the last update first.
+    if (m_bufferSize > 0)
+    {
+        std::size_t count = std::min(stripeSize - m_bufferSize, size);
+        std::memcpy(m_buffer + m_bufferSize, current, count);
+        m_bufferSize += count;
+        current += count;
+        if (m_bufferSize < stripeSize)
+            return;
+
+        processStripes(m_lanes, m_buffer, m_buffer + stripeSize);
+        m_bufferSize = 0;
+    }
+
+    current = processStripes(m_lanes, current, end);
+
+    m_bufferSize = static_cast<std::size_t>(end - current);
+    std::memcpy(m_buffer, current, m_bufferSize);
+}
+
+uint64_t XxHash64::digest() const
+{
+    uint64_t hash;
+    if (m_totalSize >= stripeSize)
+    {
+        hash = rotateLeft(m_lanes[0], 1) + rotateLeft(m_lanes[1], 7) +
+                rotateLeft(m_lanes[2], 12) + rotateLeft(m_lanes[3], 18);
+        for (uint64_t lane: m_lanes)
+            hash = mergeRound(hash, lane);
+    }
+    else
+    {
+        hash = m_seed + prime5;
+    }
+
+    hash += m_totalSize;
+
+    const uint8_t *current = m_buffer;
+    const uint8_t *end = m_buffer + m_bufferSize;
+    for (; end - current >= 8; current += 8)
+        hash = rotateLeft(hash ^ round(0, read64(current)), 27) * prime1 + prime4;
+    for (; end - current >= 4; current += 4)
+        hash = rotateLeft(hash ^ (read32(current) * prime1), 23) * prime2 + prime3;
+    for (; current < end; ++current)
+        hash = rotateLeft(hash ^ (*current * prime5), 11) * prime1;
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t XxHash64::hash(const void *data, std::size_t size, uint64_t seed)
+{
+    XxHash64 hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+bool XxHash64::hash(std::istream &instream, char *buffer, std::size_t bufferSize,
+                    uint64_t &hash, uint64_t &size)
+{
+    XxHash64 hasher;
+    while (instream)
+    {
+        instream.read(buffer, static_cast<std::streamsize>(bufferSize));
+        hasher.update(buffer, static_cast<std::size_t>(instream.gcount()));
+    }
+
+    hash = hasher.digest();
+    size = hasher.size();
+    return instream.eof() && !instream.bad();
+}
+
+} // afk namespace
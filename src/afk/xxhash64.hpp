@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef XXHASH64_HPP
+#define XXHASH64_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+
+namespace afk {
+
+/// Streaming XXH64, a fast non-cryptographic 64-bit hash.
+/// Input is read in native byte order, so hashes are only comparable on the same machine.
+class XxHash64
+{
+public:
+    explicit XxHash64(uint64_t seed = 0) { reset(seed); }
+
+    void reset(uint64_t seed = 0);
+    void update(const void *data, std::size_t size);
+    uint64_t digest() const;
+
+    /// Total bytes hashed so far.
+    inline uint64_t size() const { return m_totalSize; }
+
+    static uint64_t hash(const void *data, std::size_t size, uint64_t seed = 0);
+    /// Hashes the rest of a stream through the caller's buffer, returns false on read errors.
+    static bool hash(std::istream &instream, char *buffer, std::size_t bufferSize,
+                     uint64_t &hash, uint64_t &size);
+
+private:
+    static const std::size_t stripeSize = 32;
+
+    uint64_t m_lanes[4];
+    uint8_t m_buffer[stripeSize];
+    std::size_t m_bufferSize;
+    uint64_t m_totalSize;
+    uint64_t m_seed;
+};
+
+} // afk namespace
+
+#endif // XXHASH64_HPP
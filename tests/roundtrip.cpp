@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) 2017 Larry Lopez
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <afk/fileformats/archive/archive.hpp>
+#include <afk/fileformats/archive/archivefactory.hpp>
+#include <afk/fileformats/pex/pexarena.hpp>
+#include <afk/fileformats/pex/pexbase.hpp>
+#include <afk/fileformats/pex/pexfactory.hpp>
+#include <afk/fileformats/pex/pexpool.hpp>
+#include <afk/fileformats/pex/pexscript.hpp>
+#include <afk/pexanonymizer.hpp>
+#include "pexcorpus.hpp"
+
+namespace bio = boost::iostreams;
+namespace pex = afk::fileformats::pex;
+namespace archive = afk::fileformats::archive;
+using afk::benchmarks::CorpusGame;
+
+namespace {
+
+/// Round trip checks over the synthetic scripts of the benchmarks. Every script is read,
+/// written, compacted, stripped and anonymized, and the result parsed again and compared
+/// with the original, so opcode and offset mistakes in the parser and the rewriters show up.
+/// Archives are packed in memory, rewritten and unpacked again.
+
+const CorpusGame games[] = { CorpusGame::skyrim, CorpusGame::skyrimSE, CorpusGame::fallout4 };
+const char *gameNames[] = { "Skyrim", "SkyrimSE", "Fallout4" };
+
+int failures = 0;
+
+bool check(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        ++failures;
+        std::cerr << "FAILED: " << what << std::endl;
+    }
+    return condition;
+}
+
+std::string toString(const std::vector<uint8_t> &data)
+{
+    return std::string(std::begin(data), std::end(data));
+}
+
+std::vector<uint8_t> toBytes(const std::string &data)
+{
+    return std::vector<uint8_t>(std::begin(data), std::end(data));
+}
+
+std::unique_ptr<pex::PexBase> readPex(const std::string &data)
+{
+    std::istringstream instream(data);
+    std::unique_ptr<pex::PexBase> pex = pex::PexFactory::createUniquePex(instream);
+    if (!pex)
+        return nullptr;
+
+    instream.clear();
+    instream.seekg(0, std::ios::beg);
+    if (pex->read(instream) != data.size())
+        return nullptr;
+
+    return pex;
+}
+
+std::string writePex(pex::PexBase &pex)
+{
+    std::ostringstream outstream;
+    pex.write(outstream);
+    return outstream.str();
+}
+
+/// Prints a parsed script with the string indexes replaced by their text, so scripts
+/// with differently ordered string tables compare equal when they mean the same thing.
+class ScriptPrinter
+{
+public:
+    explicit ScriptPrinter(const pex::PexScript &script) : m_script(script) { }
+
+    std::string printDebugInfo()
+    {
+        m_out.str(std::string());
+        const pex::PexDebugInfo &debugInfo = m_script.debugInfo;
+        m_out << "debug " << debugInfo.hasDebugInfo << ' ' << debugInfo.modificationTime << '\n';
+        for (const auto &function: debugInfo.functions)
+        {
+            m_out << "  function " << text(function.objectName) << ' ' << text(function.stateName) << ' '
+                  << text(function.functionName) << ' ' << int(function.functionType) << " lines";
+            for (uint16_t line: function.lineNumbers)
+                m_out << ' ' << line;
+            m_out << '\n';
+        }
+        for (const auto &group: debugInfo.propertyGroups)
+        {
+            m_out << "  group " << text(group.objectName) << ' ' << text(group.groupName) << ' '
+                  << text(group.docString) << ' ' << group.userFlags;
+            for (uint16_t name: group.propertyNames)
+                m_out << ' ' << text(name);
+            m_out << '\n';
+        }
+        for (const auto &order: debugInfo.structOrders)
+        {
+            m_out << "  order " << text(order.objectName) << ' ' << text(order.orderName);
+            for (uint16_t name: order.names)
+                m_out << ' ' << text(name);
+            m_out << '\n';
+        }
+        return m_out.str();
+    }
+
+    std::string printObjects()
+    {
+        m_out.str(std::string());
+        for (const auto &flag: m_script.userFlags)
+            m_out << "flag " << text(flag.name) << ' ' << int(flag.flagIndex) << '\n';
+
+        for (const auto &object: m_script.objects)
+        {
+            m_out << "object " << text(object.name) << ' ' << text(object.parentClassName) << ' '
+                  << text(object.docString) << ' ' << int(object.constFlag) << ' ' << object.userFlags << ' '
+                  << text(object.autoStateName) << '\n';
+            for (const auto &structure: object.structs)
+            {
+                m_out << "  struct " << text(structure.name) << '\n';
+                for (const auto &member: structure.members)
+                {
+                    m_out << "    member " << text(member.name) << ' ' << text(member.typeName) << ' '
+                          << member.userFlags << ' ' << value(member.value) << ' ' << int(member.constFlag) << ' '
+                          << text(member.docString) << '\n';
+                }
+            }
+            for (const auto &variable: object.variables)
+            {
+                m_out << "  variable " << text(variable.name) << ' ' << text(variable.typeName) << ' '
+                      << variable.userFlags << ' ' << value(variable.value) << ' ' << int(variable.constFlag) << '\n';
+            }
+            for (const auto &property: object.properties)
+            {
+                m_out << "  property " << text(property.name) << ' ' << text(property.type) << ' '
+                      << text(property.docString) << ' ' << property.userFlags << ' ' << int(property.flags) << ' '
+                      << text(property.autoVarName) << '\n';
+                printFunction("read", property.readHandler);
+                printFunction("write", property.writeHandler);
+            }
+            for (const auto &state: object.states)
+            {
+                m_out << "  state " << text(state.name) << '\n';
+                for (const auto &function: state.functions)
+                    printFunction(text(function.name), function.function);
+            }
+        }
+        return m_out.str();
+    }
+
+private:
+    const pex::PexScript &m_script;
+    std::ostringstream m_out;
+
+    std::string text(uint16_t index) const
+    {
+        if (index >= m_script.strings.size())
+            return "#" + std::to_string(index);
+        return '"' + m_script.strings[index].to_string() + '"';
+    }
+
+    std::string value(const pex::PexValue &value) const
+    {
+        switch (value.type)
+        {
+        case pex::PexValueType::identifier:
+            return "id:" + text(value.stringIndex);
+        case pex::PexValueType::string:
+            return "str:" + text(value.stringIndex);
+        case pex::PexValueType::integer:
+            return "int:" + std::to_string(value.integer);
+        case pex::PexValueType::real:
+            return "real:" + std::to_string(value.real);
+        case pex::PexValueType::boolean:
+            return "bool:" + std::to_string(value.boolean);
+        default:
+            return "none";
+        }
+    }
+
+    void printFunction(const std::string &name, const pex::PexFunction &function)
+    {
+        m_out << "    function " << name << ' ' << text(function.returnType) << ' ' << text(function.docString) << ' '
+              << function.userFlags << ' ' << int(function.flags) << '\n';
+        for (const auto &param: function.params)
+            m_out << "      param " << text(param.name) << ' ' << text(param.type) << '\n';
+        for (const auto &local: function.locals)
+            m_out << "      local " << text(local.name) << ' ' << text(local.type) << '\n';
+        for (const auto &instruction: function.instructions)
+        {
+            m_out << "      op " << int(instruction.opcode);
+            for (const auto &argument: instruction.arguments)
+                m_out << ' ' << value(argument);
+            m_out << '\n';
+        }
+    }
+};
+
+void checkScript(CorpusGame game, const std::string &gameName)
+{
+    const std::string original = toString(afk::benchmarks::makePex(game, 8, true));
+
+    /// Reading and writing without changes gives back the same bytes.
+    std::unique_ptr<pex::PexBase> script = readPex(original);
+    if (!check(script != nullptr, gameName + ": read"))
+        return;
+    check(writePex(*script) == original, gameName + ": write is byte for byte identical");
+
+    pex::PexArena arena;
+    pex::PexScript parsed;
+    if (!check(script->parseData(arena, parsed), gameName + ": parse"))
+        return;
+    check(parsed.objects.size() == 1, gameName + ": one object");
+    check(parsed.debugInfo.hasDebugInfo, gameName + ": debug info");
+
+    ScriptPrinter printer(parsed);
+    const std::string debugInfo = printer.printDebugInfo();
+    const std::string objects = printer.printObjects();
+    const std::size_t stringCount = parsed.strings.size();
+
+    /// Compacting drops the unused string and the two duplicates, nothing else changes.
+    std::unique_ptr<pex::PexBase> compacted = readPex(original);
+    check(compacted->compactStringTable(), gameName + ": compact");
+    std::unique_ptr<pex::PexBase> reread = readPex(writePex(*compacted));
+    pex::PexArena compactedArena;
+    pex::PexScript compactedParsed;
+    if (check(reread && reread->parseData(compactedArena, compactedParsed), gameName + ": parse compacted"))
+    {
+        ScriptPrinter compactedPrinter(compactedParsed);
+        check(compactedParsed.strings.size() == stringCount - 3, gameName + ": compacted string count");
+        check(compactedPrinter.printDebugInfo() == debugInfo, gameName + ": compacted debug info");
+        check(compactedPrinter.printObjects() == objects, gameName + ": compacted objects");
+        check(reread->getUserName() == script->getUserName(), gameName + ": compacted header");
+    }
+
+    /// Stripping only empties the debug info.
+    std::unique_ptr<pex::PexBase> stripped = readPex(original);
+    check(stripped->stripDebugInfo(), gameName + ": strip");
+    reread = readPex(writePex(*stripped));
+    pex::PexArena strippedArena;
+    pex::PexScript strippedParsed;
+    if (check(reread && reread->parseData(strippedArena, strippedParsed), gameName + ": parse stripped"))
+    {
+        check(!strippedParsed.debugInfo.hasDebugInfo && strippedParsed.debugInfo.functions.empty(),
+              gameName + ": stripped debug info");
+        check(ScriptPrinter(strippedParsed).printObjects() == objects, gameName + ": stripped objects");
+    }
+
+    /// All of it together, the names must be gone from the whole file.
+    afk::PexAnonymizer::Options options;
+    options.stripDebug = true;
+    options.compactStrings = true;
+    options.maskNames = true;
+    afk::PexAnonymizer anonymizer(options);
+    pex::PexPool pool;
+    std::ostringstream log;
+    std::vector<uint8_t> out;
+    const std::vector<uint8_t> data = toBytes(original);
+    if (check(anonymizer.anonymize(gameName, data.data(), data.size(), out, pool, log)
+              == afk::PexAnonymizer::Status::anonymized, gameName + ": anonymize"))
+    {
+        const std::string anonymized = toString(out);
+        check(anonymized.find("BenchmarkUser") == std::string::npos, gameName + ": user name masked");
+        check(anonymized.find("BENCHMARK-PC") == std::string::npos, gameName + ": machine name masked");
+
+        reread = readPex(anonymized);
+        pex::PexArena anonymizedArena;
+        pex::PexScript anonymizedParsed;
+        if (check(reread && reread->parseData(anonymizedArena, anonymizedParsed), gameName + ": parse anonymized"))
+            check(ScriptPrinter(anonymizedParsed).printObjects() == objects, gameName + ": anonymized objects");
+    }
+}
+
+/// Little endian writer for the archive headers and records.
+class ArchiveWriter
+{
+public:
+    void u16(uint16_t value) { unsignedValue(value, 2); }
+    void u32(uint32_t value) { unsignedValue(value, 4); }
+    void u64(uint64_t value) { unsignedValue(value, 8); }
+    void bytes(const std::string &value) { m_data.append(value); }
+    void bytes(const std::vector<uint8_t> &value) { m_data.append(std::begin(value), std::end(value)); }
+
+    void patch32(std::size_t offset, uint32_t value)
+    {
+        for (std::size_t i = 0; i < 4; ++i)
+            m_data[offset + i] = static_cast<char>(value >> (8 * i));
+    }
+
+    std::size_t size() const { return m_data.size(); }
+    const std::string& data() const { return m_data; }
+
+private:
+    std::string m_data;
+
+    void unsignedValue(uint64_t value, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            m_data.push_back(static_cast<char>(value >> (8 * i)));
+    }
+};
+
+std::string zlibCompress(const std::vector<uint8_t> &data)
+{
+    std::string result;
+    {
+        bio::filtering_ostream stream;
+        stream.push(bio::zlib_compressor());
+        stream.push(bio::back_inserter(result));
+        stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+    return result;
+}
+
+struct ArchiveEntry
+{
+    std::string folder;
+    std::string name;
+    std::vector<uint8_t> data;
+    bool compressed;
+};
+
+/// General BA2, version 1.
+std::string packBa2(const std::vector<ArchiveEntry> &entries)
+{
+    ArchiveWriter writer;
+    writer.bytes(std::string("BTDX"));
+    writer.u32(1);
+    writer.bytes(std::string("GNRL"));
+    writer.u32(static_cast<uint32_t>(entries.size()));
+    writer.u64(0);
+
+    std::vector<std::string> stored;
+    for (const auto &entry: entries)
+        stored.push_back(entry.compressed ? zlibCompress(entry.data) : toString(entry.data));
+
+    const std::size_t dataStart = 24 + 36 * entries.size();
+    std::size_t offset = dataStart;
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        writer.u32(static_cast<uint32_t>(i));
+        writer.bytes(std::string("pex\0", 4));
+        writer.u32(0);
+        writer.u32(0x00100100);
+        writer.u64(offset);
+        writer.u32(entries[i].compressed ? static_cast<uint32_t>(stored[i].size()) : 0);
+        writer.u32(static_cast<uint32_t>(entries[i].data.size()));
+        writer.u32(0xBAADF00D);
+        offset += stored[i].size();
+    }
+    for (const auto &data: stored)
+        writer.bytes(data);
+
+    const uint64_t nameTableOffset = writer.size();
+    for (const auto &entry: entries)
+    {
+        const std::string path = entry.folder + "\\" + entry.name;
+        writer.u16(static_cast<uint16_t>(path.size()));
+        writer.bytes(path);
+    }
+
+    writer.patch32(0x10, static_cast<uint32_t>(nameTableOffset));
+    return writer.data();
+}
+
+/// Skyrim BSA, version 104 with folder and file names, compressed by default and
+/// the full path embedded in front of the data. Stored files flip the compression bit.
+std::string packBsa(const std::vector<ArchiveEntry> &entries)
+{
+    std::vector<std::string> folders;
+    for (const auto &entry: entries)
+        if (folders.empty() || (folders.back() != entry.folder))
+            folders.push_back(entry.folder);
+
+    std::size_t folderNamesLength = 0;
+    std::size_t fileNamesLength = 0;
+    for (const auto &folder: folders)
+        folderNamesLength += folder.size() + 1;
+    for (const auto &entry: entries)
+        fileNamesLength += entry.name.size() + 1;
+
+    ArchiveWriter writer;
+    writer.bytes(std::string("BSA\0", 4));
+    writer.u32(104);
+    writer.u32(36);
+    writer.u32(0x001 | 0x002 | 0x004 | 0x100);
+    writer.u32(static_cast<uint32_t>(folders.size()));
+    writer.u32(static_cast<uint32_t>(entries.size()));
+    writer.u32(static_cast<uint32_t>(folderNamesLength));
+    writer.u32(static_cast<uint32_t>(fileNamesLength));
+    writer.u32(0);
+
+    for (std::size_t i = 0; i < folders.size(); ++i)
+    {
+        uint32_t count = 0;
+        for (const auto &entry: entries)
+            if (entry.folder == folders[i])
+                ++count;
+        writer.u64(i);
+        writer.u32(count);
+        writer.u32(0);
+    }
+
+    std::vector<std::string> stored;
+    for (const auto &entry: entries)
+    {
+        std::string data;
+        const std::string path = entry.folder + "\\" + entry.name;
+        data.push_back(static_cast<char>(path.size()));
+        data.append(path);
+        if (entry.compressed)
+        {
+            ArchiveWriter originalSize;
+            originalSize.u32(static_cast<uint32_t>(entry.data.size()));
+            data.append(originalSize.data());
+            data.append(zlibCompress(entry.data));
+        }
+        else
+        {
+            data.append(toString(entry.data));
+        }
+        stored.push_back(data);
+    }
+
+    std::vector<std::size_t> sizeOffsets;
+    for (const auto &folder: folders)
+    {
+        writer.bytes(std::string(1, static_cast<char>(folder.size() + 1)));
+        writer.bytes(folder + '\0');
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].folder != folder)
+                continue;
+            writer.u64(i);
+            sizeOffsets.push_back(writer.size());
+            writer.u32(static_cast<uint32_t>(stored[i].size()) | (entries[i].compressed ? 0 : 0x40000000));
+            writer.u32(0);
+        }
+    }
+    for (const auto &entry: entries)
+        writer.bytes(entry.name + '\0');
+
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        writer.patch32(sizeOffsets[i] + 4, static_cast<uint32_t>(writer.size()));
+        writer.bytes(stored[i]);
+    }
+    return writer.data();
+}
+
+bool isScript(const std::string &name)
+{
+    return (name.size() > 4) && (name.compare(name.size() - 4, 4, ".pex") == 0);
+}
+
+/// Reads every file of an archive, by rewriting it with a handler that keeps a copy.
+bool unpack(const std::string &data, std::vector<std::string> &names, std::vector<std::vector<uint8_t>> &files)
+{
+    std::istringstream instream(data);
+    std::unique_ptr<archive::Archive> unpacked = archive::ArchiveFactory::createUniqueArchive(instream);
+    if (!unpacked || !unpacked->readDirectory(instream))
+        return false;
+
+    names.clear();
+    files.clear();
+    std::stringstream scratch;
+    archive::ArchiveRewriteResult result;
+    return unpacked->rewrite(instream, scratch, [](const std::string &) { return true; },
+                             [&](const std::string &name, std::vector<uint8_t> &file) {
+                                 names.push_back(name);
+                                 files.push_back(file);
+                                 return false;
+                             }, result);
+}
+
+void checkArchive(const std::string &format, std::string (*pack)(const std::vector<ArchiveEntry> &))
+{
+    const std::vector<uint8_t> text = toBytes("Not a script, copied as is.\n");
+    const std::vector<ArchiveEntry> entries = {
+        { "scripts", "compressed.pex", afk::benchmarks::makePex(CorpusGame::skyrim), true },
+        { "scripts", "stored.pex", afk::benchmarks::makePex(CorpusGame::skyrim, 3), false },
+        { "readme", "readme.txt", text, true },
+    };
+    const std::string packed = pack(entries);
+
+    /// Unpacking the archive as built gives back the files, so the checks below test the rewrite.
+    std::vector<std::string> names;
+    std::vector<std::vector<uint8_t>> files;
+    if (!check(unpack(packed, names, files) && (files.size() == entries.size()), format + ": unpack"))
+        return;
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        check(names[i] == entries[i].folder + "\\" + entries[i].name, format + ": name " + entries[i].name);
+        check(files[i] == entries[i].data, format + ": data " + entries[i].name);
+    }
+
+    afk::PexAnonymizer anonymizer;
+    pex::PexPool pool;
+    std::ostringstream log;
+    auto anonymize = [&](const std::string &name, std::vector<uint8_t> &data) {
+        std::vector<uint8_t> out;
+        if (anonymizer.anonymize(name, data.data(), data.size(), out, pool, log)
+                != afk::PexAnonymizer::Status::anonymized)
+            return false;
+        data.swap(out);
+        return true;
+    };
+
+    std::istringstream instream(packed);
+    std::unique_ptr<archive::Archive> original = archive::ArchiveFactory::createUniqueArchive(instream);
+    if (!check(original && original->readDirectory(instream), format + ": read directory"))
+        return;
+
+    std::stringstream outstream;
+    archive::ArchiveRewriteResult result;
+    if (!check(original->rewrite(instream, outstream, isScript, anonymize, result), format + ": rewrite"))
+        return;
+    check((result.handled == 2) && (result.changed == 2) && (result.skipped == 0), format + ": rewrite counts");
+
+    if (!check(unpack(outstream.str(), names, files) && (files.size() == entries.size()), format + ": unpack rewritten"))
+        return;
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        std::vector<uint8_t> expected = entries[i].data;
+        if (isScript(entries[i].name))
+            anonymize(entries[i].name, expected);
+
+        check(names[i] == entries[i].folder + "\\" + entries[i].name, format + ": rewritten name " + entries[i].name);
+        check(files[i] == expected, format + ": rewritten data " + entries[i].name);
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    try
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+            checkScript(games[i], gameNames[i]);
+
+        checkArchive("BA2", packBa2);
+        checkArchive("BSA", packBsa);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (failures)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "All round trip checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = afkpexanon_tests
+CONFIG += console c++14 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+include(../AFKPexAnonCore.pri)
+
+INCLUDEPATH += $$PWD/../benchmarks
+
+SOURCES += \
+    ../benchmarks/pexcorpus.cpp \
+    roundtrip.cpp
+
+HEADERS += \
+    ../benchmarks/pexcorpus.hpp